@@ -0,0 +1,86 @@
+
+#include "neslib.h"
+#include "vrambuf.h"
+#include "audio.h"
+#include "debug.h"
+
+// dados em sounds.s
+extern const byte dragon_music[];
+extern const byte dragon_sounds[];
+
+byte audio_nmi_pending = 0;
+byte audio_nmi_done = 0;
+byte audio_nmi_bytes;
+
+// stream, prioridade (maior vence) e duração em quadros de cada efeito
+typedef struct {
+  byte stream;
+  byte priority;
+  byte frames;
+} SfxInfo;
+
+const SfxInfo sfx_info[SFX_COUNT] = {
+  { 0, 1,  8 },   // SFX_JUMP:  pulso 1
+  { 1, 2, 12 },   // SFX_SCORE: pulso 2
+  { 0, 3, 30 },   // SFX_CRASH: pulso 1 e ruído
+};
+
+// efeito em cada stream, enquanto o temporizador não zera
+static byte stream_priority[AUDIO_STREAMS];
+static byte stream_timer[AUDIO_STREAMS];
+
+void audio_init(void) {
+  byte i;
+  famitone_init((void*)dragon_music);
+  sfx_init((void*)dragon_sounds);
+  for (i = 0; i < AUDIO_STREAMS; i++) {
+    stream_timer[i] = 0;
+  }
+  audio_nmi_pending = 0;
+  audio_nmi_done = 0;
+  audio_set_budget(NMI_CYCLES_CAP - NMI_CYCLES_FIXED, AUDIO_UPDATE_CYCLES);
+}
+
+void audio_set_budget(word free_cycles, word audio_cycles) {
+  word bytes;
+
+  if (free_cycles < audio_cycles) {
+    audio_nmi_bytes = 0;
+    return;
+  }
+  bytes = (free_cycles - audio_cycles) / NMI_CYCLES_PER_BYTE + 1;
+  audio_nmi_bytes = bytes > 255 ? 255 : bytes;
+}
+
+void audio_sfx(byte sfx) {
+  register const SfxInfo* info = &sfx_info[sfx];
+  byte s = info->stream;
+
+  if (stream_timer[s] && stream_priority[s] > info->priority) {
+    return;
+  }
+  sfx_play(sfx, s);
+  stream_priority[s] = info->priority;
+  stream_timer[s] = info->frames;
+}
+
+void audio_schedule(void) {
+  byte i;
+
+  for (i = 0; i < AUDIO_STREAMS; i++) {
+    if (stream_timer[i]) --stream_timer[i];
+  }
+
+  // Com o buffer deste quadro, o NMI mais o áudio ainda terminam antes
+  // do sprite zero? Se não, o áudio espera o split.
+  audio_nmi_pending = (updptr < audio_nmi_bytes);
+}
+
+void audio_update_deferred(void) {
+  if (audio_nmi_done) {
+    audio_nmi_done = 0;
+  } else {
+    famitone_update();
+    ++dbg.audio_deferred;
+  }
+}
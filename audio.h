@@ -0,0 +1,88 @@
+
+#ifndef _AUDIO_H
+#define _AUDIO_H
+
+#include "neslib.h"
+#include "vrambuf.h"
+
+// Música e efeitos com a FamiTone2 (famitone2.s), com arbitragem dos
+// efeitos e um teto de ciclos para o NMI.
+//
+// O famitone_update roda no fim do callback do NMI (raster.s), depois de
+// todo o trabalho da PPU. No fim de cada quadro, audio_schedule() compara o
+// tamanho do buffer da VRAM com o maior buffer que ainda deixa o NMI e o
+// pior caso do áudio terminarem antes do sprite zero (audio_set_budget());
+// acima dele, o update daquele quadro é adiado para depois do split
+// (audio_update_deferred()). Com o custo estimado de hoje, o adiamento
+// nunca acontece (ver AUDIO_DEFER_CYCLES).
+
+// Efeitos (índices da lista em sounds.s)
+#define SFX_JUMP  0
+#define SFX_SCORE 1
+#define SFX_CRASH 2
+#define SFX_COUNT 3
+
+// Streams de efeito da FamiTone usados (FT_SFX_STREAMS >= 2).
+// Efeitos que disputam o mesmo canal da APU usam o mesmo stream.
+#define AUDIO_STREAMS 2
+
+// Custo do NMI em ciclos de CPU, do início até o fim do callback, com o
+// mesmo modelo do flush usado no teto de upload (vrambuf.h)
+#define NMI_CYCLES_FIXED    (VRAMBUF_NMI_CYCLES + 170)  // + callback de raster.s com 4 splits
+#define NMI_CYCLES_PER_BYTE VRAMBUF_BYTE_CYCLES
+
+// Janela do NMI: do início do vblank (linha 241) até o sprite zero (y = 22,
+// linha 23), ou seja, 20 linhas de vblank, a pré-render e 23 linhas; menos
+// o caminho de main até o primeiro teste do sprite zero e uma linha de margem
+#define NMI_WINDOW_LINES    (20 + 1 + 23)
+#define NMI_MAIN_CYCLES     300   // ppu_wait_nmi, idle_begin, vrambuf_clear e raster_wait_sprite0
+#define NMI_MARGIN_CYCLES   114
+#define NMI_CYCLES_CAP      (NMI_WINDOW_LINES * 341 / 3 - NMI_MAIN_CYCLES - NMI_MARGIN_CYCLES)
+
+// Pior caso do famitone_update com os efeitos do jogo. Ainda é uma
+// estimativa: trocar pelo "pior caso" que o tools/nes_trace --map mede em
+// cada chamada (no NMI e adiada), numa partida longa com --random, e
+// repetir o número no cost _famitone_update do tools/wcet.txt.
+// AUDIO_CALIBRATE em dragons_leap.c mede o custo e a folga até o sprite
+// zero na própria ROM e troca as estimativas pelas medidas
+// (audio_set_budget()).
+#define AUDIO_UPDATE_CYCLES 1800
+
+// Acima deste custo do famitone_update o teto adia o áudio em algum quadro:
+// abaixo dele, audio_nmi_bytes passa de VRAMBUF_FRAME_MAX, que o updptr
+// nunca passa (vrambuf.h). Com as estimativas de hoje são 2149 ciclos, e os
+// 1800 de AUDIO_UPDATE_CYCLES dão audio_nmi_bytes = 90: o teto nunca age e
+// o famitone_update sempre roda no NMI. Ele só passa a valer se o custo
+// medido (tools/nes_trace --map) passar deste valor, ou se o AUDIO_CALIBRATE
+// medir menos folga até o sprite zero; o nes_trace então mostra os quadros
+// adiados.
+#define AUDIO_DEFER_CYCLES \
+  (NMI_CYCLES_CAP - NMI_CYCLES_FIXED - VRAMBUF_FRAME_MAX * NMI_CYCLES_PER_BYTE)
+
+// Sinalizadores compartilhados com o callback do NMI (raster.s)
+extern byte audio_nmi_pending;  // o próximo NMI deve chamar famitone_update
+extern byte audio_nmi_done;     // o último NMI chamou famitone_update
+
+// O áudio roda no NMI quando updptr < audio_nmi_bytes (0 = nunca)
+extern byte audio_nmi_bytes;
+
+// Inicializa a FamiTone (música parada) e os efeitos
+void audio_init(void);
+
+// Toca um efeito, a menos que um efeito de prioridade maior ainda esteja
+// tocando no mesmo stream
+void audio_sfx(byte sfx);
+
+// Ciclos livres no NMI para o flush e o áudio e custo do famitone_update:
+// calcula o maior buffer com que o áudio ainda roda no NMI. audio_init()
+// usa NMI_CYCLES_CAP - NMI_CYCLES_FIXED e AUDIO_UPDATE_CYCLES.
+void audio_set_budget(word free_cycles, word audio_cycles);
+
+// Fim do quadro, depois do último vrambuf_put: decide se o próximo
+// famitone_update roda no NMI e avança os temporizadores dos efeitos
+void audio_schedule(void);
+
+// Depois do split do sprite zero: roda o update que o NMI não rodou
+void audio_update_deferred(void);
+
+#endif // audio.h
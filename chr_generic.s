@@ -1,2 +1,4 @@
+.export _tileset_chr
 .segment "CHARS"
-.incbin "tileset.chr"
\ No newline at end of file
+_tileset_chr:
+.incbin "tileset.chr"
@@ -0,0 +1,26 @@
+
+#include "neslib.h"
+#include "vrambuf.h"
+#include "chrstream.h"
+
+// envio em andamento
+static word chr_stream_dest;
+static const byte* chr_stream_src;
+byte chr_stream_left = 0;
+
+void chr_stream_start(word dest, const byte* src, byte count) {
+  chr_stream_dest = dest;
+  chr_stream_src = src;
+  chr_stream_left = count;
+}
+
+bool chr_stream_update(void) {
+  // um tile por vez, enquanto houver espaço no orçamento do quadro
+  while (chr_stream_left && VRAMBUF_FITS(CHR_TILE_BYTES)) {
+    vrambuf_put(chr_stream_dest, chr_stream_src, CHR_TILE_BYTES);
+    chr_stream_dest += CHR_TILE_BYTES;
+    chr_stream_src += CHR_TILE_BYTES;
+    --chr_stream_left;
+  }
+  return chr_stream_left == 0;
+}
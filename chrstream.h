@@ -0,0 +1,30 @@
+
+#ifndef _CHRSTREAM_H
+#define _CHRSTREAM_H
+
+#include "neslib.h"
+
+// Bytes de um tile na pattern table (2 planos de 8 bytes)
+#define CHR_TILE_BYTES 16
+
+// Endereço na PPU de um tile no formato 0xTNN (T = pattern table 0/1)
+#define CHR_TILE_ADDR(tile) ((word)(tile) << 4)
+
+// Inicia o envio de "count" tiles consecutivos de "src" para a CHR-RAM,
+// começando no endereço "dest". Só um envio fica ativo por vez.
+void chr_stream_start(word dest, const byte* src, byte count);
+
+// Enfileira no buffer da VRAM os tiles pendentes que ainda cabem no
+// orçamento de upload do quadro (VRAMBUF_FRAME_MAX, no máximo 3 tiles).
+// Chamar depois de todas as atualizações de nametable do quadro, que têm
+// prioridade.
+// Retorna true quando o envio atual terminou (ou não há envio).
+bool chr_stream_update(void);
+
+// Tiles pendentes no envio atual (0 = nenhum)
+extern byte chr_stream_left;
+
+// Descarta o envio atual
+#define chr_stream_cancel() (chr_stream_left = 0)
+
+#endif // chrstream.h
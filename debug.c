@@ -0,0 +1,14 @@
+
+#include "debug.h"
+#include "raster.h"
+
+DebugCounters dbg;
+
+void dbg_split_slack(word polls) {
+  dbg.split_slack = polls;
+  if (polls > RASTER_POLL_LATE) {
+    ++dbg.sprite0_late;
+  } else if (polls < dbg.split_slack_min || !dbg.split_slack_min) {
+    dbg.split_slack_min = polls;
+  }
+}
@@ -0,0 +1,30 @@
+
+#ifndef _DEBUG_H
+#define _DEBUG_H
+
+#include "neslib.h"
+
+// Contadores de depuração, atualizados a cada quadro.
+// Ficam juntos na RAM (símbolo _dbg) para serem lidos no visualizador
+// de memória do emulador.
+typedef struct {
+  byte oam_bytes;         // bytes escritos no buffer da OAM no último quadro
+  word level_seed;        // semente da partida atual (tools/reach_solver --seed)
+  word split_slack;       // folga até o sprite zero no último quadro (voltas de RASTER_POLL_CYCLES)
+  word split_slack_min;   // menor folga desde o início
+  byte sprite0_late;      // quadros em que o NMI passou da linha do sprite zero
+  byte audio_deferred;    // quadros com o famitone_update fora do NMI
+  word audio_cycles;      // pior caso medido do famitone_update (AUDIO_CALIBRATE)
+  byte hotpath_errors;    // divergências entre C e assembly (HOTPATH_SELFTEST)
+  byte idle_steps;        // passos das tarefas de fundo no último quadro (idle.c)
+  byte idle_cut;          // quadros em que o prazo chegou com tarefa pendente
+  byte invariant_errors;  // violações das invariantes do jogo (CHECK_INVARIANTS)
+  byte invariant_last;    // última invariante violada (CHECK_*)
+} DebugCounters;
+
+extern DebugCounters dbg;
+
+// Registra a folga devolvida por raster_wait_sprite0()
+void dbg_split_slack(word polls);
+
+#endif // debug.h
@@ -0,0 +1,22 @@
+// Quadros de animação do dragão para streaming na CHR-RAM.
+// Cada quadro tem 4 tiles (TL, TR, BL, BR) de 16 bytes no formato da PPU
+// (8 bytes do plano 0 seguidos de 8 bytes do plano 1).
+#define DRAGON_FRAME_COUNT 2
+#define DRAGON_FRAME_BYTES 64
+
+const unsigned char dragon_frames[DRAGON_FRAME_COUNT][DRAGON_FRAME_BYTES]={
+// Quadro 0: asas abaixadas (tiles originais do tileset)
+{
+0x00,0x00,0x01,0x01,0x03,0x03,0x03,0x07,0x00,0x00,0x00,0x00,0x00,0x01,0x01,0x00,
+0x00,0xee,0xab,0x39,0x03,0x2a,0x2a,0x01,0x00,0x00,0x44,0xc6,0xfc,0xd4,0xd4,0xfe,
+0x1f,0x3e,0x3c,0x38,0x13,0x1f,0x0e,0x00,0x02,0x15,0x0b,0x17,0x0e,0x0e,0x00,0x00,
+0x8b,0x41,0x3e,0x5c,0x3a,0x7e,0xf8,0x70,0x74,0xbe,0xc0,0xb8,0xdc,0x98,0x70,0x00
+},
+// Quadro 1: asas levantadas
+{
+0x00,0x00,0x01,0x01,0x1f,0x3f,0x3f,0x3b,0x00,0x00,0x00,0x00,0x00,0x15,0x09,0x14,
+0x00,0xee,0xab,0x39,0x03,0x2a,0x2a,0x01,0x00,0x00,0x44,0xc6,0xfc,0xd4,0xd4,0xfe,
+0x13,0x1e,0x0c,0x00,0x03,0x03,0x02,0x00,0x0e,0x0d,0x03,0x03,0x02,0x02,0x00,0x00,
+0x8b,0x41,0x3e,0x5c,0x3a,0x7e,0xf8,0x70,0x74,0xbe,0xc0,0xb8,0xdc,0x98,0x70,0x00
+}
+};
@@ -6,10 +6,22 @@
 #include <stdlib.h>
 #include <string.h>
 
+// Configuração do cartucho: MMC3 com 64 KB de PRG em bancos
+#define NES_MAPPER 4                // Mapper 4 (MMC3)
+#define NES_PRG_BANKS 4             // Número de bancos de 16 KB de PRG
+#define NES_CHR_BANKS 0             // 0 = 8 KB de CHR-RAM (tiles copiados na inicialização)
+
+//#resource "dragons_leap.cfg"      // Configuração do linker com os bancos
+#define CFGFILE dragons_leap.cfg
+
 // Bibliotecas Específicas do NES
 #include "neslib.h"                 // Biblioteca NESlib com funções úteis para o NES
 #include <nes.h>                    // Header do CC65 para o NES (definições da PPU)
 
+// Troca de bancos do mapper
+#include "mmc3.h"                   // Registradores do MMC3 e trampolim de bancos
+//#link "mmc3.s"
+
 // Utilitários de Aritmética e VRAM
 #include "bcd.h"                    // Suporte para aritmética BCD (Decimal Codificado em Binário)
 //#link "bcd.c"
@@ -19,11 +31,118 @@
 
 // Dados Gráficos (CHR)
 //#resource "tileset.chr"           // Dados do conjunto de caracteres (CHR)
-//#link "chr_generic.s"             // Vincula a pattern table à ROM de CHR
+//#link "chr_generic.s"             // Vincula a pattern table ao banco BANK_CHR de PRG
+
+#include "chrstream.h"              // Envio de tiles para a CHR-RAM pelo buffer da VRAM
+//#link "chrstream.c"
+
+// OAM com controle de alterações e contadores de depuração
+#include "oamshadow.h"
+//#link "oamshadow.s"
+#include "debug.h"
+//#link "debug.c"
+
+// Splits de scroll no meio do quadro (IRQ do MMC3)
+#include "raster.h"
+//#link "raster.c"
+//#link "raster.s"
+
+// Música e efeitos sonoros (FamiTone2)
+#include "audio.h"
+//#link "audio.c"
+//#link "famitone2.s"
+//#link "sounds.s"
+
+// Rotinas quentes em assembly, com as versões em C como referência
+#include "hotpath.h"
+//#link "hotpath.s"
+
+// Tarefas de fundo no tempo que sobra de cada quadro
+#include "idle.h"
+//#link "idle.c"
+
+// HOTPATH_ASM e CHECK_INVARIANTS podem vir de fora: o build do host
+// (tools/fuzz_logic.c) usa as versões em C e liga as invariantes
+#ifndef HOTPATH_ASM
+#define HOTPATH_ASM      1      // 1 = usa as versões de hotpath.s; 0 = só as versões em C
+#endif
+#define HOTPATH_SELFTEST 0      // 1 = compara as versões em C e em assembly ao ligar
+
+// As versões em C só são compiladas quando usadas
+#define HOTPATH_REFERENCE (!HOTPATH_ASM || HOTPATH_SELFTEST)
+
+#ifndef CHECK_INVARIANTS
+#define CHECK_INVARIANTS 0      // 1 = confere as invariantes do jogo a cada quadro (ver INVARIANTES)
+#endif
+
+
+
+//--------------------------------------------------------//
+//                  BANCOS SELECIONÁVEIS                  //
+//--------------------------------------------------------//
+
+// Bancos de PRG usados pelo jogo (ver dragons_leap.cfg)
+#define BANK_LEVEL 0            // Nametables e dados de fase
+#define BANK_CHR   1            // tileset.chr (copiado para a CHR-RAM)
+
+extern const byte tileset_chr[];    // Definido em chr_generic.s
+
+// Funções em bancos selecionáveis são chamadas pelo trampolim,
+// que troca o banco, chama a função e restaura o banco anterior.
+// (o identificador do pragma é o número do banco: BANK_LEVEL)
+#pragma wrapped-call (push, bank_trampoline, 0)
+void load_background(word nametable);
+#pragma wrapped-call (pop)
+
+#pragma code-name (push, "BANK0")
+#pragma rodata-name (push, "BANK0")
 
 // Nametable do Background
 #include "nametable_background.h"
 
+// Copia a nametable de fundo para a VRAM (somente com a PPU desligada)
+void load_background(word nametable) {
+    vram_adr(nametable);
+    vram_write(nametable_background, 1024); // Escreve os 1024 bytes da nametable
+}
+
+#pragma rodata-name (pop)
+#pragma code-name (pop)
+
+// O resto do jogo fica no banco 6 ($C000), que só é fixo depois que o
+// mmc3_init() escolhe o modo 0 de PRG; main() e tudo o que roda antes dela
+// (crt0, neslib, NMI) ficam no banco 7 ($E000), o único fixo no reset.
+// Ver dragons_leap.cfg.
+#pragma code-name (push, "GAMECODE")
+#pragma rodata-name (push, "GAMEDATA")
+
+
+//--------------------------------------------------------//
+//                  MEMÓRIA POR ESTADO                    //
+//--------------------------------------------------------//
+
+// Cada estado do jogo (título, jogo, fim de jogo) tem a sua RAM de trabalho
+// em um overlay: os segmentos STATE_TITLE, STATE_PLAY e STATE_OVER ocupam
+// o mesmo endereço (ver dragons_leap.cfg), assim como ZP_TITLE, ZP_PLAY e
+// ZP_OVER na zero page. O conteúdo de um overlay só vale enquanto o seu
+// estado está ativo, e a função de entrada do estado o inicializa.
+// Variáveis em overlay não podem ter inicializador (iriam para DATA).
+//
+// Variáveis de zero page são reservadas em state_ram.s e declaradas aqui
+// com #pragma zpsym, para o cc65 usar o endereçamento de zero page.
+//
+// O uso de cada overlay aparece no relatório de tools/bank_report.sh.
+
+//#link "state_ram.s"
+
+#define STATE_TITLE    0        // Tela de título, espera START
+#define STATE_PLAY     1        // Jogo em andamento
+#define STATE_GAMEOVER 2        // Fim de jogo, espera START para recomeçar
+
+byte game_state;                // Estado atual (STATE_*)
+
+word level_start_seed = 1;      // Semente da próxima partida (conta quadros fora do jogo)
+
 
 //--------------------------------------------------------//
 //                CONFIGURAÇÃO DA PALETA                  //
@@ -45,51 +164,67 @@ const char PALETTE[32] = {
 };
 
 //--------------------------------------------------------//
-//                   SISTEMA DE SUBPIXEL                  //
+//              FÍSICA, GEOMETRIA E FASES                 //
 //--------------------------------------------------------//
 
-// Configuração de ponto fixo (subpixels) para movimento suave
-#define SUBPIXEL_SHIFT 4                        // 2^4 = 16 subpixels por pixel
-#define SUBPIXEL_UNIT (1 << SUBPIXEL_SHIFT)     // Representa 1 pixel em unidades de subpixel (16)
+// Subpixels, física do dragão, dimensões das torres e colisão
+// (compartilhados com as ferramentas do host em tools/)
+#include "physics.h"
+
+// Sequência de gaps das torres gerada a partir de uma semente
+#include "level.h"
 
 
 //--------------------------------------------------------//
 //                 METASPRITE DO DRAGÃO                   //
 //--------------------------------------------------------//
 
-// Define os índices dos tiles que compõem o dragão
-#define TILE_DRAGON_TL 0x111                         // Tile Superior Esquerdo do Dragão
-#define TILE_DRAGON_TR 0x112                         // Tile Superior Direito do Dragão
-#define TILE_DRAGON_BL 0x121                         // Tile Inferior Esquerdo do Dragão
-#define TILE_DRAGON_BR 0x122                         // Tile Inferior Direito do Dragão
+// Quadros de animação (4 tiles de 16 bytes cada), enviados para a CHR-RAM
+#include "dragon_frames.h"
+
+#define DRAGON_FRAME_GLIDE 0                         // Asas abaixadas
+#define DRAGON_FRAME_FLAP  1                         // Asas levantadas
+
+// O dragão usa dois conjuntos de 4 tiles consecutivos (TL, TR, BL, BR) na
+// pattern table dos sprites. Enquanto um conjunto é exibido, o outro recebe
+// o próximo quadro; a troca só acontece quando os 4 tiles foram enviados.
+#define TILE_DRAGON_SET_A 0x113                      // Conjunto A (0x113-0x116)
+#define TILE_DRAGON_SET_B 0x117                      // Conjunto B (0x117-0x11A)
 
 // Definição de um metasprite de 16x16 pixels, composto por 4 sprites de 8x8.
 // Formato: {posição_x, posição_y, id_do_tile, atributos}
-const unsigned char dragon_metasprite[] = {
-    0,  0,  TILE_DRAGON_TL, 0,                    // Sprite superior esquerdo
-    8,  0,  TILE_DRAGON_TR, 0,                    // Sprite superior direito
-    0,  8,  TILE_DRAGON_BL, 0,                    // Sprite inferior esquerdo
-    8,  8,  TILE_DRAGON_BR, 0,                    // Sprite inferior direito
+const unsigned char dragon_metasprite_a[] = {
+    0,  0,  TILE_DRAGON_SET_A+0, 0,               // Sprite superior esquerdo
+    8,  0,  TILE_DRAGON_SET_A+1, 0,               // Sprite superior direito
+    0,  8,  TILE_DRAGON_SET_A+2, 0,               // Sprite inferior esquerdo
+    8,  8,  TILE_DRAGON_SET_A+3, 0,               // Sprite inferior direito
     128                                           // Terminador da lista de sprites
 };
 
+const unsigned char dragon_metasprite_b[] = {
+    0,  0,  TILE_DRAGON_SET_B+0, 0,
+    8,  0,  TILE_DRAGON_SET_B+1, 0,
+    0,  8,  TILE_DRAGON_SET_B+2, 0,
+    8,  8,  TILE_DRAGON_SET_B+3, 0,
+    128
+};
+
+const unsigned char* const dragon_metasprites[2] = {
+    dragon_metasprite_a,
+    dragon_metasprite_b
+};
+
+const word dragon_tile_sets[2] = {
+    TILE_DRAGON_SET_A,
+    TILE_DRAGON_SET_B
+};
+
 
 //--------------------------------------------------------//
 //                   VARIÁVEIS DO DRAGÃO                  //
 //--------------------------------------------------------//
 
-// Constantes de posição do dragão
-#define DRAGON_X_POS 50                 // Posição X fixa do dragão em pixels
-#define DRAGON_INIT_Y_POS 50            // Posição Y inicial do dragão em pixels
-
-// Limites de movimento vertical do dragão na tela
-#define DRAGON_MIN_Y 28                 // Limite superior da tela para o jogador
-#define DRAGON_MAX_Y 194                // Limite inferior da tela para o jogador
-
-// Constantes da física do dragão
-#define GRAVITY 4                       // Força da gravidade aplicada ao dragão (em subpixels/quadro²)
-#define MAX_GRAVITY 80                  // Velocidade máxima de queda (em subpixels/quadro)
-#define JUMP_SPEED -64                  // Velocidade inicial do pulo (negativa para subir)
+// Posição, limites e constantes da física do dragão: ver physics.h
 
 
 // Estrutura que armazena todas as variáveis do dragão
@@ -102,12 +237,27 @@ typedef struct {
 } Dragon;
 
 // Declara a variável global para o nosso dragão
-Dragon dragon;
+// (zero page do estado de jogo, reservada em state_ram.s)
+extern Dragon dragon;
+#pragma zpsym ("dragon")
+
+#ifdef __CC65__
+// state_ram.s reserva DRAGON_ZP_SIZE bytes; falha a compilação se o struct mudar
+#define DRAGON_ZP_SIZE 6
+typedef char dragon_zp_size_check[(sizeof(Dragon) == DRAGON_ZP_SIZE) ? 1 : -1];
+#endif
 
 
 void initialize_dragon();
+void dragon_physics_step_c(byte jump);
 void update_dragon_physics();
 
+#if HOTPATH_ASM
+#define dragon_physics_step dragon_physics_step_asm
+#else
+#define dragon_physics_step dragon_physics_step_c
+#endif
+
 
 // Inicializa a posição e o estado do dragão.
 void initialize_dragon() {
@@ -122,38 +272,79 @@ void initialize_dragon() {
 }
 
 
-// Atualiza a física de movimento do dragão (pulo e gravidade).
+#if HOTPATH_REFERENCE
+// Um quadro da física do dragão (pulo e gravidade).
+// O passo em si está em physics.h, para que tools/reach_solver.c use
+// exatamente as mesmas contas.
+void dragon_physics_step_c(byte jump) {
+    DRAGON_PHYSICS_STEP(dragon, jump);
+}
+#endif
+
+
+// Atualiza a física de movimento do dragão e toca o som do pulo.
 void update_dragon_physics() {
-    // Verifica se o botão A foi pressionado para iniciar um pulo
-    if (pad_trigger(0) & PAD_A) {  
-        dragon.y_vel = JUMP_SPEED;      // Define a velocidade vertical para o pulo
-    }
-    
-    // Aplica a força da gravidade à velocidade vertical
-    dragon.y_vel += GRAVITY;
-    // Limita a velocidade de queda para evitar que o dragão caia rápido demais
-    if (dragon.y_vel > MAX_GRAVITY) { 
-        dragon.y_vel = MAX_GRAVITY;
+    // O pulo começa no quadro em que o botão A foi pressionado
+    byte jump = pad_trigger(0) & PAD_A;
+
+    dragon_physics_step(jump);
+
+    if (jump) {
+        audio_sfx(SFX_JUMP);
     }
-    
-    // Atualiza a posição de subpixel com base na velocidade atual
-    dragon.y_pos_subpixel += dragon.y_vel;
-    
-    // Converte a posição de subpixel de volta para pixels para o desenho na tela
-    // (divisão por 16, feita com um deslocamento de bits à direita)
-    dragon.y_pos = dragon.y_pos_subpixel >> SUBPIXEL_SHIFT;
-    
-    // Mantém o dragão dentro dos limites verticais da tela
-    if (dragon.y_pos < DRAGON_MIN_Y) {
-        dragon.y_pos = DRAGON_MIN_Y;
-        dragon.y_pos_subpixel = dragon.y_pos << SUBPIXEL_SHIFT;
-        dragon.y_vel = 0; // Para o movimento ascendente ao bater no teto
+}
+
+
+//--------------------------------------------------------//
+//                 ANIMAÇÃO DO DRAGÃO                     //
+//--------------------------------------------------------//
+
+// Estas variáveis descrevem o conteúdo da CHR-RAM, que não muda entre
+// estados, por isso ficam fora dos overlays.
+byte dragon_tile_set = 0;         // Conjunto de tiles exibido (0 = A, 1 = B)
+byte dragon_frame_shown = 0;      // Quadro presente no conjunto exibido
+byte dragon_frame_next = 0;       // Quadro sendo enviado para o outro conjunto
+bool dragon_frame_streaming = false;
+
+
+void initialize_dragon_tiles();
+void update_dragon_animation();
+
+
+// Grava o primeiro quadro no conjunto A (somente com a PPU desligada).
+void initialize_dragon_tiles() {
+    vram_adr(CHR_TILE_ADDR(TILE_DRAGON_SET_A));
+    vram_write(dragon_frames[DRAGON_FRAME_GLIDE], DRAGON_FRAME_BYTES);
+
+    dragon_tile_set = 0;
+    dragon_frame_shown = DRAGON_FRAME_GLIDE;
+    dragon_frame_streaming = false;
+}
+
+
+// Escolhe o quadro pela velocidade vertical e envia os tiles para o
+// conjunto que não está na tela, usando só o que sobrou do orçamento de
+// upload do quadro depois das torres. Pode levar mais de um quadro para
+// terminar.
+void update_dragon_animation() {
+    byte frame = (dragon.y_vel < 0) ? DRAGON_FRAME_FLAP : DRAGON_FRAME_GLIDE;
+
+    if (!dragon_frame_streaming) {
+        if (frame == dragon_frame_shown) {
+            return;
+        }
+        dragon_frame_next = frame;
+        dragon_frame_streaming = true;
+        chr_stream_start(CHR_TILE_ADDR(dragon_tile_sets[dragon_tile_set ^ 1]),
+                         dragon_frames[frame], DRAGON_FRAME_BYTES / CHR_TILE_BYTES);
     }
-  
-    if (dragon.y_pos > DRAGON_MAX_Y) {
-        dragon.y_pos = DRAGON_MAX_Y;
-        dragon.y_pos_subpixel = dragon.y_pos << SUBPIXEL_SHIFT;
-        dragon.y_vel = 0; // Para o movimento descendente ao bater no chão
+
+    if (chr_stream_update()) {
+        // Os últimos tiles e a OAM apontando para o novo conjunto
+        // são enviados no mesmo vblank, então a troca não aparece pela metade
+        dragon_tile_set ^= 1;
+        dragon_frame_shown = dragon_frame_next;
+        dragon_frame_streaming = false;
     }
 }
 
@@ -164,27 +355,54 @@ void update_dragon_physics() {
 
 #define NES_MIRRORING 1         // Ativa o Vertical Mirroring para o scroll horizontal
 
-#define SCROLL_SPEED 16         // Velocidade do scroll em subpixels por quadro
+// Velocidade inicial do scroll (SCROLL_SPEED): ver physics.h.
+// Eventos EV_SPEED da linha do tempo podem mudá-la durante a fase.
 
 #define TILE_SPRITE_ZERO 0x11E  // Índice do Tile utilizado como Sprite Zero
 
-int scroll_x_subpixel = 0;    // Posição do scroll em subpixels
-word scroll_x = 0;            // Posição do scroll em pixels (0-511)
+// A câmera é usada por todos os estados (o fim de jogo mantém a tela
+// congelada), por isso fica na zero page permanente (state_ram.s).
+extern int scroll_x_subpixel;   // Posição do scroll em subpixels
+extern word scroll_x;           // Posição do scroll em pixels (0-511)
+#pragma zpsym ("scroll_x_subpixel")
+#pragma zpsym ("scroll_x")
+
+byte scroll_speed;              // Velocidade atual em subpixels por quadro
 
 
-void update_scroll();
+void initialize_scroll();
+bool update_scroll_c();
 void setup_sprite_zero();
+
+#if HOTPATH_ASM
+#define update_scroll update_scroll_asm
+#else
+#define update_scroll update_scroll_c
+#endif
   
-// Atualiza a variável de scroll (a posição da câmera)
-void update_scroll() { 
-    scroll_x_subpixel += SCROLL_SPEED;
+// Volta a câmera para o início da nametable A
+void initialize_scroll() {
+    scroll_x_subpixel = 0;
+    scroll_x = 0;
+    scroll_speed = SCROLL_SPEED;
+}
+
+
+#if HOTPATH_REFERENCE
+// Atualiza a variável de scroll (a posição da câmera).
+// Retorna true no quadro em que a câmera dá a volta nos 512 pixels.
+bool update_scroll_c() { 
+    scroll_x_subpixel += scroll_speed;
     scroll_x = scroll_x_subpixel >> SUBPIXEL_SHIFT;
 
     if (scroll_x >= 512) {
         scroll_x -= 512;
         scroll_x_subpixel -= (512 << SUBPIXEL_SHIFT);
+        return true;
     }
+    return false;
 }
+#endif
 
 // Função dedicada para configurar o sprite zero uma única vez.
 void setup_sprite_zero() {
@@ -197,6 +415,68 @@ void setup_sprite_zero() {
 }
 
 
+//--------------------------------------------------------//
+//                 PARALAXE (SPLITS POR IRQ)              //
+//--------------------------------------------------------//
+
+#define RASTER_DEBUG 0          // 1 = marca as linhas dos splits na tela (escala de cinza)
+
+// Camadas horizontais abaixo do split do sprite zero, cada uma com o seu
+// scroll. A velocidade é relativa ao scroll principal, em quartos.
+// Os scanlines vão para o tools/nes_trace --splits, que confere a linha em
+// que cada split da IRQ vale.
+typedef struct {
+    byte scanline;              // Primeira linha da camada na tela
+    byte speed;                 // Velocidade em quartos da do scroll (4 = igual às torres)
+} ParallaxLayer;
+
+#define NUM_PARALLAX_LAYERS 1
+
+const ParallaxLayer parallax_layers[NUM_PARALLAX_LAYERS] = {
+    { 208, 6 },                 // Chão (linhas 26-29 da nametable), 1,5x mais rápido
+};
+
+#pragma bss-name (push, "STATE_PLAY")
+
+// Posição de cada camada em subpixels (0 até 512 << SUBPIXEL_SHIFT)
+word parallax_x_subpixel[NUM_PARALLAX_LAYERS];
+
+#pragma bss-name (pop)
+
+
+void initialize_parallax();
+void update_parallax();
+
+
+void initialize_parallax() {
+    byte i;
+    for (i = 0; i < NUM_PARALLAX_LAYERS; i++) {
+        parallax_x_subpixel[i] = 0;
+    }
+    raster_debug = RASTER_DEBUG;
+}
+
+
+// Avança as camadas e agenda os splits do próximo quadro.
+// Cada camada tem seu próprio acumulador, para dar a volta nos 512 pixels
+// sem saltos qualquer que seja a velocidade.
+void update_parallax() {
+    byte i;
+    word x;
+
+    raster_begin();
+    for (i = 0; i < NUM_PARALLAX_LAYERS; i++) {
+        x = parallax_x_subpixel[i] + (((word)scroll_speed * parallax_layers[i].speed) >> 2);
+        if (x >= (512 << SUBPIXEL_SHIFT)) {
+            x -= (512 << SUBPIXEL_SHIFT);
+        }
+        parallax_x_subpixel[i] = x;
+        raster_add(parallax_layers[i].scanline, x >> SUBPIXEL_SHIFT);
+    }
+    raster_end();
+}
+
+
 //--------------------------------------------------------//
 //                  VARIÁVEIS DAS TORRES                  //
 //--------------------------------------------------------//
@@ -210,20 +490,23 @@ void setup_sprite_zero() {
 #define TILE_BOT_MID    0xA9
 #define TILE_BOT_RIGHT  0xAA
 
-// Parâmetros da torre
-#define TOWER_HEIGHT       22      // Altura total da torre (em tiles verticais)
-#define TOWER_COLUMNS      4       // Número de colunas por torre (L, M, M, R)
-#define TOWER_GAP_START    8       // Tile onde começa o espaço (gap)
-#define TOWER_GAP_HEIGHT   6       // Tamanho vertical do gap em tiles
+// Parâmetros da torre (altura, colunas, gap): ver physics.h
+#define TOWER_GAP_START    8       // Gap inicial, antes da primeira geração
 
 // Dimensões da tela em tiles
 #define SCREEN_WIDTH_TILES 32
-#define SCORE_HEIGHT 4             // Linhas reservadas para a pontuação
 
 // Número total de torres fixas no jogo (duas por nametable)
 #define NUM_TOWERS 4
 
+// Gaps sorteados com antecedência pelo trabalho de fundo (potência de 2)
+#define LEVEL_LOOKAHEAD 4
+
+// Linhas da attribute table cobertas por uma torre
+#define TOWER_ATTR_ROWS ((TOWER_HEIGHT / 4) + 1)
+
 // Posições de scroll (em tiles) que disparam o redesenho de cada torre
+// (eventos EV_TOWER da linha do tempo)
 #define SCROLL_TOWER_0 31
 #define SCROLL_TOWER_1 46
 #define SCROLL_TOWER_2 0
@@ -236,53 +519,103 @@ typedef struct {
     byte base_collum;     // Coluna base dentro da nametable (0 ou 16)
     byte gap_start;       // Define onde a lacuna da torre começa
     bool drawn;           // Indica se essa torre já foi desenhada neste ciclo
+    bool visible;         // Há uma torre desta posição na nametable (para colisão)
+    bool scored;          // O dragão já passou desta torre (ponto contado)
 } Tower;
 
+// Posição fixa de cada torre nas nametables
+const byte tower_slot_nametable[NUM_TOWERS] = {
+    0,      // Torre 0 → NT A, colunas 0–3
+    0,      // Torre 1 → NT A, colunas 16–19
+    1,      // Torre 2 → NT B, colunas 0–3 (32-35)
+    1       // Torre 3 → NT B, colunas 16–19 (48-51)
+};
+const byte tower_slot_column[NUM_TOWERS] = { 0, 16, 0, 16 };
+
+#pragma bss-name (push, "STATE_PLAY")
+
 Tower towers[NUM_TOWERS];
 
-byte tower_palette_index = 0;  // escolher entre 0–3 (qual das 4 paletas BG)
+byte tower_palette_index;      // escolher entre 0–3 (qual das 4 paletas BG)
+
+byte color_buffer[TOWER_ATTR_ROWS];        // uma entrada por linha da attribute table
+
+byte tower_column_buffer[TOWER_HEIGHT];     // coluna montada por draw_tower_column()
+
+word level_seed;               // Semente do último gap sorteado (level.h)
+byte level_gaps[LEVEL_LOOKAHEAD];  // Gaps já sorteados, em ordem (fila circular)
+byte level_gaps_head;          // Primeiro gap da fila
+byte level_gaps_count;         // Gaps na fila
 
-byte color_buffer[TOWER_HEIGHT / 4];
+word score;                    // Pontuação em BCD (4 dígitos)
+byte score_digits[4];          // Dígitos da pontuação em tiles
+word score_next;               // score + 1, calculado pelo trabalho de fundo
+byte score_next_digits[4];     // Dígitos de score_next em tiles
+bool score_next_ready;         // score_next vale para o score atual
+
+byte tower_job;                // Torre sendo desenhada, uma coluna por quadro (NO_TOWER = nenhuma)
+
+#pragma bss-name (pop)
+
+#define NO_TOWER 0xFF
+
+#if CHECK_INVARIANTS
+byte check_tower_draws[NUM_TOWERS];     // Torres completas desde a última volta do scroll
+void check_tower_cycle();
+#endif
 
 
 void initialize_towers();
-void fill_tower_column(byte *buffer, byte column, byte gap_start);
-word nametable_to_attribute_addr(word a);
+void fill_tower_column_c(byte *buffer, byte column, byte gap_start);
+word nametable_to_attribute_addr_c(word a);
 void fill_color_buffer(byte palette_index);
-void put_color(word addr);
+void put_color(word addr, const byte* colors);
 void draw_tower_column(Tower* tower);
-void update_towers(word scroll_x);
+void start_tower(byte i);
+void update_towers();
+int tower_screen_x(byte i);
+bool dragon_hits_tower();
+void draw_score();
+void update_score();
+byte level_next_gap();
+void format_score(byte* digits, word value);
+void add_score_point();
+bool idle_level_lookahead();
+bool idle_score_format();
+
+#if HOTPATH_ASM
+#define fill_tower_column           fill_tower_column_asm
+#define nametable_to_attribute_addr nametable_to_attribute_addr_asm
+#else
+#define fill_tower_column           fill_tower_column_c
+#define nametable_to_attribute_addr nametable_to_attribute_addr_c
+#endif
   
   
 void initialize_towers() {
     byte i;
-  
-    // Torre 0 → NT A, colunas 0–3
-    towers[0].nametable_id = 0;
-    towers[0].base_collum = 0;
-
-    // Torre 1 → NT A, colunas 16–19
-    towers[1].nametable_id = 0;
-    towers[1].base_collum = 16;
 
-    // Torre 2 → NT B, colunas 0–3 (32-35)
-    towers[2].nametable_id = 1;
-    towers[2].base_collum = 0;
-
-    // Torre 3 → NT B, colunas 16–19 (48-51)
-    towers[3].nametable_id = 1;
-    towers[3].base_collum = 16;
+    tower_palette_index = 0;
 
     for (i = 0; i < NUM_TOWERS; i++) {
+        towers[i].nametable_id = tower_slot_nametable[i];
+        towers[i].base_collum = tower_slot_column[i];
         towers[i].collum_index = 0;
         towers[i].drawn = false;
+        towers[i].visible = false;
+        towers[i].scored = false;
         towers[i].gap_start = TOWER_GAP_START;
+#if CHECK_INVARIANTS
+        check_tower_draws[i] = 0;
+#endif
     }
+    tower_job = NO_TOWER;
 }
 
 
+#if HOTPATH_REFERENCE
 // Preenche a coluna de tiles no buffer
-void fill_tower_column(byte *buffer, byte column, byte gap_start) {
+void fill_tower_column_c(byte *buffer, byte column, byte gap_start) {
     byte top_tile;
     byte bottom_tile;
   
@@ -308,29 +641,36 @@ void fill_tower_column(byte *buffer, byte column, byte gap_start) {
         }
     }
 }
+#endif
 
 
 
 void draw_tower_column(Tower* tower) {
-    static byte buffer[TOWER_HEIGHT];
-  
     word base_nametable;
     word addr;
 
-    fill_tower_column(buffer, tower->collum_index, tower->gap_start);
+    // A primeira coluna sorteia o gap da torre. Ela é desenhada fora da
+    // tela, e o gap vale para a colisão até a torre ser redesenhada.
+    if (tower->collum_index == 0) {
+        tower->gap_start = level_next_gap();
+        tower->visible = true;
+        tower->scored = false;
+    }
+
+    fill_tower_column(tower_column_buffer, tower->collum_index, tower->gap_start);
 
     base_nametable = (tower->nametable_id == 0) ? NAMETABLE_A : NAMETABLE_B;
 
     // Desenha da linha 4 até 25 (posição vertical de torre no background)
     addr = base_nametable + tower->base_collum + tower->collum_index + (SCREEN_WIDTH_TILES * SCORE_HEIGHT); 
 
-    vrambuf_put(addr | VRAMBUF_VERT, buffer, TOWER_HEIGHT);
+    vrambuf_put(addr | VRAMBUF_VERT, tower_column_buffer, TOWER_HEIGHT);
 
     // Se for a primeira coluna da torre, escreve os atributos
     if (tower->collum_index == 0) {
         word attr_addr = nametable_to_attribute_addr(addr);
         fill_color_buffer(tower_palette_index);  // ou 1, 2, 3...
-        put_color(attr_addr);
+        put_color(attr_addr, color_buffer);
     }
   
     tower->collum_index++;
@@ -343,53 +683,263 @@ void draw_tower_column(Tower* tower) {
 }
 
 
-void update_towers(word scroll_x) {
-    byte scroll_tile = scroll_x >> 3;
+// Começa a redesenhar a torre i com o próximo gap da fase
+void start_tower(byte i) {
+    towers[i].drawn = false;
+    towers[i].collum_index = 0;
+    tower_job = i;
+}
+
+
+// Desenha uma coluna da torre em andamento por quadro, para caber no
+// buffer da VRAM junto com o resto do quadro
+void update_towers() {
+    if (tower_job == NO_TOWER) {
+        return;
+    }
+
+    draw_tower_column(&towers[tower_job]);
+    if (towers[tower_job].drawn) {
+#if CHECK_INVARIANTS
+        ++check_tower_draws[tower_job];
+#endif
+        tower_job = NO_TOWER;
+    }
+}
+
+
+// Posição X da torre na tela (-256 a 255), calculada no espaço de
+// 512 pixels do scroll.
+int tower_screen_x(byte i) {
+    int tx = (((word)towers[i].nametable_id << 8) + (towers[i].base_collum << 3) - scroll_x) & 511;
+    if (tx >= 256) {
+        tx -= 512;
+    }
+    return tx;
+}
+
+
+// Verifica se o dragão bateu em alguma torre visível.
+bool dragon_hits_tower() {
+    byte i;
+
+    for (i = 0; i < NUM_TOWERS; i++) {
+        if (!towers[i].visible) {
+            continue;
+        }
+
+        if (TOWER_OVERLAPS_DRAGON(tower_screen_x(i)) && !DRAGON_IN_GAP(dragon.y_pos, towers[i].gap_start)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+//--------------------------------------------------------//
+//                LINHA DO TEMPO DA FASE                  //
+//--------------------------------------------------------//
+
+// Eventos disparados pela posição do scroll, numa lista em ROM ordenada
+// por x. Um cursor aponta o próximo evento e a posição dele fica guardada
+// em timeline_next_x: sem evento no quadro, o custo é uma comparação,
+// qualquer que seja o tamanho da lista. A lista descreve uma volta de
+// 512 pixels e recomeça quando o scroll dá a volta.
+
+#define EV_TOWER   0    // Redesenha a torre "param" com um novo gap
+#define EV_PALETTE 1    // Paleta do BG (0-3) das próximas torres
+#define EV_SPEED   2    // Velocidade do scroll em subpixels por quadro
+                        // (tools/reach_solver.c supõe SCROLL_SPEED constante)
+
+#define TIMELINE_END_X 0xFFFF   // Sentinela no fim da lista, nunca alcançada
+
+typedef struct {
+    word x;             // Posição do scroll em pixels (0-511)
+    byte type;          // EV_*
+    byte param;
+} TimelineEvent;
+
+// Ordenada por x
+const TimelineEvent level_timeline[] = {
+    { SCROLL_TOWER_2 << 3, EV_TOWER, 2 },     // Início da NT B
+    { SCROLL_TOWER_3 << 3, EV_TOWER, 3 },     // Meio da NT B
+    { SCROLL_TOWER_0 << 3, EV_TOWER, 0 },     // Início da NT A
+    { SCROLL_TOWER_1 << 3, EV_TOWER, 1 },     // Meio da NT A
+    { TIMELINE_END_X, 0, 0 }
+};
+
+#pragma bss-name (push, "STATE_PLAY")
+
+byte timeline_cursor;          // Próximo evento da lista
+word timeline_next_x;          // Posição dele (cópia de level_timeline[timeline_cursor].x)
+
+#pragma bss-name (pop)
+
+
+void timeline_reset();
+void timeline_dispatch();
+void timeline_update(bool wrapped);
+
+
+// Volta para o início da lista (início da fase ou volta do scroll)
+void timeline_reset() {
+    timeline_cursor = 0;
+    timeline_next_x = level_timeline[0].x;
+}
+
+
+// Executa o evento do cursor e avança para o próximo
+void timeline_dispatch() {
+    register const TimelineEvent* ev = &level_timeline[timeline_cursor];
+
+    switch (ev->type) {
+        case EV_TOWER:   start_tower(ev->param);            break;
+        case EV_PALETTE: tower_palette_index = ev->param;   break;
+        case EV_SPEED:   scroll_speed = ev->param;          break;
+    }
+
+    ++timeline_cursor;
+    timeline_next_x = level_timeline[timeline_cursor].x;
+}
+
 
-    // Torre 2 → scroll tile 0 (inicio da NT B)
-    if (scroll_tile == SCROLL_TOWER_2 && !towers[2].drawn) {
-        draw_tower_column(&towers[2]);
-        // Torre 0 saiu da tela
-        towers[0].drawn = false;
-        towers[0].collum_index = 0;
-        towers[0].gap_start = TOWER_GAP_START;
+// Dispara os eventos alcançados por scroll_x. "wrapped" vem de
+// update_scroll(): os eventos que faltavam no fim da volta anterior
+// (o scroll pode pular pixels) são disparados antes de recomeçar a lista.
+void timeline_update(bool wrapped) {
+    if (wrapped) {
+        while (timeline_next_x != TIMELINE_END_X) {
+            timeline_dispatch();
+        }
+        timeline_reset();
     }
 
-    // Torre 3 → scroll tile 15 (meio da NT B)
-    if (scroll_tile == SCROLL_TOWER_3 && !towers[3].drawn) {
-        draw_tower_column(&towers[3]);
-        // Torre 1 saiu da tela
-        towers[1].drawn = false;
-        towers[1].collum_index = 0;
-        towers[1].gap_start = TOWER_GAP_START;
+    while (timeline_next_x <= scroll_x) {
+        timeline_dispatch();
     }
+}
+
+
+//--------------------------------------------------------//
+//                      PONTUAÇÃO                         //
+//--------------------------------------------------------//
+
+// Dígitos depois de "SCORE:" na barra de status
+#define SCORE_X 8
+#define SCORE_Y 1
+
+// Dígitos de uma pontuação em BCD (tiles dos dígitos = ASCII)
+void format_score(byte* digits, word value) {
+    digits[0] = '0' + (value >> 12);
+    digits[1] = '0' + ((value >> 8) & 0x0F);
+    digits[2] = '0' + ((value >> 4) & 0x0F);
+    digits[3] = '0' + (value & 0x0F);
+}
 
-    // Torre 0 → scroll tile 31 (inicio da NT A)
-    if (scroll_tile == SCROLL_TOWER_0 && !towers[0].drawn) {
-        draw_tower_column(&towers[0]);
-        // Torre 2 saiu da tela
-        towers[2].drawn = false;
-        towers[2].collum_index = 0;
-        towers[2].gap_start = TOWER_GAP_START;
+
+// Escreve a pontuação na barra de status
+void draw_score() {
+    format_score(score_digits, score);
+    vrambuf_put(NTADR_A(SCORE_X, SCORE_Y), score_digits, 4);
+}
+
+
+// Soma um ponto. Usa a pontuação seguinte já formatada pelo trabalho de
+// fundo (idle_score_format()) quando ela está pronta.
+void add_score_point() {
+    if (score_next_ready) {
+        score = score_next;
+        score_next_ready = false;
+        vrambuf_put(NTADR_A(SCORE_X, SCORE_Y), score_next_digits, 4);
+        return;
     }
+    score = bcd_add(score, 1);
+    draw_score();
+}
+
 
-    // Torre 1 → scroll tile 46 (meio da NT A)
-    if (scroll_tile == SCROLL_TOWER_1 && !towers[1].drawn) {
-        draw_tower_column(&towers[1]);
-        // Torre 3 saiu da tela
-        towers[3].drawn = false;
-        towers[3].collum_index = 0;
-        towers[3].gap_start = TOWER_GAP_START;
+// Conta um ponto para cada torre cuja borda direita passou da caixa de
+// colisão do dragão (o mesmo critério de tools/reach_solver.c).
+void update_score() {
+    byte i;
+
+    for (i = 0; i < NUM_TOWERS; i++) {
+        if (!towers[i].visible || towers[i].scored) {
+            continue;
+        }
+
+        if (tower_screen_x(i) + TOWER_WIDTH_PX <= DRAGON_X_POS + DRAGON_HIT_INSET) {
+            towers[i].scored = true;
+            add_score_point();
+            audio_sfx(SFX_SCORE);
+        }
     }
 }
 
 
-word nametable_to_attribute_addr(word a) {
+//--------------------------------------------------------//
+//                  TRABALHO DE FUNDO                     //
+//--------------------------------------------------------//
+
+// Tarefas de idle_run() (idle.h), no tempo que sobra depois da lógica do
+// quadro. Só trabalham durante o jogo, quando o overlay STATE_PLAY é válido.
+
+// Gap da próxima torre: o primeiro da fila, se o trabalho de fundo já o
+// sorteou, senão sorteia agora. A sequência é a mesma nos dois casos.
+byte level_next_gap() {
+    byte gap;
+
+    if (level_gaps_count) {
+        gap = level_gaps[level_gaps_head];
+        level_gaps_head = (level_gaps_head + 1) & (LEVEL_LOOKAHEAD - 1);
+        --level_gaps_count;
+        return gap;
+    }
+    LEVEL_NEXT_SEED(level_seed);
+    return LEVEL_GAP(level_seed);
+}
+
+
+// Sorteia um gap à frente (o xorshift de 16 bits custa caro no cc65)
+bool idle_level_lookahead() {
+    if (game_state != STATE_PLAY || level_gaps_count == LEVEL_LOOKAHEAD) {
+        return false;
+    }
+    LEVEL_NEXT_SEED(level_seed);
+    level_gaps[(level_gaps_head + level_gaps_count) & (LEVEL_LOOKAHEAD - 1)] = LEVEL_GAP(level_seed);
+    ++level_gaps_count;
+    return true;
+}
+
+
+// Calcula e formata a pontuação do próximo ponto
+bool idle_score_format() {
+    if (game_state != STATE_PLAY || score_next_ready) {
+        return false;
+    }
+    score_next = bcd_add(score, 1);
+    format_score(score_next_digits, score_next);
+    score_next_ready = true;
+    return true;
+}
+
+
+#define IDLE_TASKS 2
+
+const IdleTask idle_tasks[IDLE_TASKS] = {
+    idle_level_lookahead,
+    idle_score_format,
+};
+
+
+#if HOTPATH_REFERENCE
+word nametable_to_attribute_addr_c(word a) {
     return (a & 0x2C00)       // mantém origem da nametable (0x2000 ou 0x2400)
          | 0x03C0             // início da attribute table
          | ((a >> 4) & 0x38)  // linha (cada 4 tiles → shift 4)
          | ((a >> 2) & 0x07); // coluna (cada 4 tiles → shift 2)
 }
+#endif
 
 
 void fill_color_buffer(byte palette_index) {
@@ -400,16 +950,16 @@ void fill_color_buffer(byte palette_index) {
     attr |= (palette_index << 4);
     attr |= (palette_index << 6);
 
-    for (i = 0; i < (TOWER_HEIGHT / 4) + 1; i++) {
+    for (i = 0; i < TOWER_ATTR_ROWS; i++) {
         color_buffer[i] = attr;  // aplica mesma cor em toda a coluna
     }
 }
 
 
-void put_color(word addr) {
+void put_color(word addr, const byte* colors) {
     byte i;
-    for (i = 0; i < (TOWER_HEIGHT / 4) + 1; i++) {
-        vrambuf_put(addr, &color_buffer[i], 1);
+    for (i = 0; i < TOWER_ATTR_ROWS; i++) {
+        vrambuf_put(addr, &colors[i], 1);
         addr += 8;  // próxima linha da attribute table (cada linha tem 8 bytes)
     }
 }
@@ -420,43 +970,586 @@ void put_color(word addr) {
 //                  FUNÇÕES AUXILIARES                    //
 //--------------------------------------------------------//
 
+// Copia o tileset do banco BANK_CHR para a CHR-RAM (somente com a PPU desligada).
+void load_tileset() {
+    byte bank = mmc3_prg_bank;
+
+    mmc3_set_prg_8000(BANK_CHR);
+    vram_adr(0x0000);
+    vram_write(tileset_chr, 0x2000);
+    mmc3_set_prg_8000(bank);
+}
+
+
 // Configura a PPU (Unidade de Processamento de Imagem) e as tabelas gráficas.
 void setup_graphics() {
     oam_clear();              // Limpa o buffer OAM, escondendo todos os sprites
+    oam_shadow_reset();       // Nenhum slot em uso no "quadro anterior"
 
     pal_all(PALETTE);         // Carrega a paleta de cores predefinida para o fundo e os sprites
 
     bank_bg(0);               // Usa o banco de CHR 0 para os tiles do background
     bank_spr(1);              // Usa o banco de CHR 1 para os tiles dos sprites
+
+    load_tileset();           // Preenche a CHR-RAM com o tileset
+    initialize_dragon_tiles();
   
-    // Desenha o fundo inicial nas nametables
-    vram_adr(NAMETABLE_A);
-    vram_write(nametable_background, 1024); // Escreve os 1024 bytes da nametable 
-    vram_adr(NAMETABLE_B);
-    vram_write(nametable_background, 1024);
+    // Desenha o fundo inicial nas nametables (dados no banco BANK_LEVEL)
+    load_background(NAMETABLE_A);
+    load_background(NAMETABLE_B);
 }
 
 
 // Desenha todos os sprites do jogo na tela.
+// Só os bytes da OAM que mudaram desde o quadro anterior são reescritos
+// (o total vai para dbg.oam_bytes).
 void draw_sprites() { 
-    // Começa a desenhar a partir do slot 1, pois o slot 0 está reservado para o sprite zero.
-    // Cada sprite ocupa 4 bytes no OAM, então o próximo ID livre é 4.
-    char oam_id = 4; // Inicializa o contador de sprites no primeiro slot livre da OAM
+    // Começa a desenhar a partir do slot 1 (OAM_FIRST_FREE), pois o slot 0 está reservado para o sprite zero.
+    oam_shadow_begin();
 
     // Desenha o metasprite do dragão na sua posição atual
-    oam_id = oam_meta_spr(dragon.x_pos, dragon.y_pos, oam_id, dragon_metasprite);
+    oam_shadow_meta(dragon.x_pos, dragon.y_pos, dragon_metasprites[dragon_tile_set]);
+
+    // Esconde só os slots que estavam em uso no quadro anterior, para evitar "sprites fantasmas"
+    oam_shadow_end();
+}
+
+
+//--------------------------------------------------------//
+//                   ESTADOS DO JOGO                      //
+//--------------------------------------------------------//
+
+// Mensagens na barra de status (linha 1, ao lado de "SCORE:")
+#define MSG_X   12
+#define MSG_Y   1
+#define MSG_LEN 11
+#define TILE_STATUS_BLANK 0x03  // Tile vazio da barra de status
+
+const char MSG_PRESS_START[MSG_LEN] = {
+    'P','R','E','S','S',TILE_STATUS_BLANK,'S','T','A','R','T'
+};
+const char MSG_GAME_OVER[MSG_LEN] = {
+    'G','A','M','E',TILE_STATUS_BLANK,'O','V','E','R',TILE_STATUS_BLANK,TILE_STATUS_BLANK
+};
+const char MSG_BLANK[MSG_LEN] = {
+    TILE_STATUS_BLANK,TILE_STATUS_BLANK,TILE_STATUS_BLANK,TILE_STATUS_BLANK,
+    TILE_STATUS_BLANK,TILE_STATUS_BLANK,TILE_STATUS_BLANK,TILE_STATUS_BLANK,
+    TILE_STATUS_BLANK,TILE_STATUS_BLANK,TILE_STATUS_BLANK
+};
+
+#define TITLE_BLINK_MASK 0x20   // A mensagem pisca a cada 32 quadros
+
+#pragma bss-name (push, "STATE_TITLE")
+byte title_timer;               // Contador para piscar "PRESS START"
+#pragma bss-name (pop)
+
+#pragma bss-name (push, "STATE_OVER")
+byte gameover_timer;            // Quadros desde o fim do jogo
+bool restart_requested;         // START apertado: apagando as torres para recomeçar
+byte restart_dirty;             // Torres que ainda sujam as nametables (um bit por torre)
+byte restart_step;              // Próxima coluna da primeira torre suja (TOWER_COLUMNS = atributos)
+byte restart_tiles[TOWER_HEIGHT];       // Coluna do fundo original
+byte restart_attrs[TOWER_ATTR_ROWS];    // Atributos do fundo original sob a torre
+#pragma bss-name (pop)
+
+#define GAMEOVER_MIN_FRAMES 60  // Ignora START logo após a queda
+
+// Bytes que put_color() acrescenta ao buffer da VRAM (cabeçalho + 1 por linha)
+#define RESTART_ATTR_BYTES (TOWER_ATTR_ROWS * 4)
+
+// Bytes que a entrada em STATE_PLAY acrescenta (mensagem apagada e pontuação)
+#define PLAY_ENTRY_BYTES (3 + MSG_LEN + 3 + 4)
+
+
+// Lê do fundo original (banco BANK_LEVEL) o que há sob uma coluna de torre
+#pragma wrapped-call (push, bank_trampoline, 0)
+void load_background_column(byte column, byte* tiles, byte* attrs);
+#pragma wrapped-call (pop)
+
+void set_game_state(byte state);
+byte dirty_towers();
+bool clear_dirty_towers();
+void update_title();
+void update_play();
+void update_gameover();
+
+
+// Troca de estado. A função de entrada inicializa o overlay do novo estado,
+// pois ele ocupa a mesma memória que o do estado anterior.
+void set_game_state(byte state) {
+    game_state = state;
+
+    switch (state) {
+        case STATE_TITLE:
+            title_timer = 0;
+            break;
+
+        case STATE_PLAY:
+            vrambuf_put(NTADR_A(MSG_X, MSG_Y), MSG_BLANK, MSG_LEN);
+            initialize_scroll();      // Define a posição inicial da câmera
+            initialize_dragon();      // Define a posição inicial do dragão
+            initialize_towers();      // Define as variáveis iniciais das torres
+            timeline_reset();         // Primeiro evento da fase
+            level_seed = level_start_seed ? level_start_seed : 1;
+            level_gaps_head = 0;
+            level_gaps_count = 0;
+            dbg.level_seed = level_seed;
+            score = 0;
+            score_next_ready = false;
+            draw_score();
+            initialize_parallax();    // Zera as camadas de paralaxe
+            chr_stream_cancel();      // Descarta um envio de tiles pela metade
+            dragon_frame_streaming = false;
+            break;
+
+        case STATE_GAMEOVER: {
+            // towers[] fica no overlay do jogo, que o do fim de jogo sobrescreve:
+            // as torres desenhadas são anotadas antes de inicializar o overlay
+            byte dirty = dirty_towers();
+
+            gameover_timer = 0;
+            restart_requested = false;
+            restart_dirty = dirty;
+            restart_step = 0;
+            vrambuf_put(NTADR_A(MSG_X, MSG_Y), MSG_GAME_OVER, MSG_LEN);
+            break;
+        }
+    }
+}
+
+
+// Torres com alguma coluna nas nametables (um bit por torre)
+byte dirty_towers() {
+    byte i;
+    byte mask = 0;
+
+    for (i = 0; i < NUM_TOWERS; i++) {
+        if (towers[i].visible) {
+            mask |= 1 << i;
+        }
+    }
+    return mask;
+}
+
+
+#pragma code-name (push, "BANK0")
+
+void load_background_column(byte column, byte* tiles, byte* attrs) {
+    const byte* src = nametable_background + (SCREEN_WIDTH_TILES * SCORE_HEIGHT) + column;
+    byte i;
+
+    for (i = 0; i < TOWER_HEIGHT; i++) {
+        tiles[i] = *src;
+        src += SCREEN_WIDTH_TILES;
+    }
+
+    // A attribute table tem 8 bytes por linha; a torre começa na linha SCORE_HEIGHT / 4
+    src = nametable_background + 0x3C0 + ((SCORE_HEIGHT / 4) << 3) + (column >> 2);
+    for (i = 0; i < TOWER_ATTR_ROWS; i++) {
+        attrs[i] = *src;
+        src += 8;
+    }
+}
+
+#pragma code-name (pop)
+
+
+// Apaga as torres da partida anterior com a PPU ligada: só as torres
+// marcadas em restart_dirty, coluna por coluna e depois os atributos,
+// copiando o fundo original pelo buffer da VRAM o quanto couber no
+// orçamento de upload de cada quadro (VRAMBUF_FRAME_MAX: duas colunas, ou
+// duas colunas e os atributos, por quadro).
+// Retorna true quando não sobrou nada para apagar.
+bool clear_dirty_towers() {
+    byte i;
+    word addr;
+
+    while (restart_dirty) {
+        // Primeira torre suja
+        for (i = 0; !(restart_dirty & (1 << i)); i++);
+
+        addr = (tower_slot_nametable[i] ? NAMETABLE_B : NAMETABLE_A)
+             + tower_slot_column[i] + (SCREEN_WIDTH_TILES * SCORE_HEIGHT);
+
+        if (restart_step < TOWER_COLUMNS) {
+            if (!VRAMBUF_FITS(TOWER_HEIGHT)) {
+                return false;
+            }
+            load_background_column(tower_slot_column[i] + restart_step, restart_tiles, restart_attrs);
+            vrambuf_put((addr + restart_step) | VRAMBUF_VERT, restart_tiles, TOWER_HEIGHT);
+            restart_step++;
+        } else {
+            // restart_attrs veio com a última coluna lida (a mesma coluna de atributos)
+            if (!VRAMBUF_ROOM(RESTART_ATTR_BYTES)) {
+                return false;
+            }
+            put_color(nametable_to_attribute_addr(addr), restart_attrs);
+            restart_dirty &= ~(1 << i);
+            restart_step = 0;
+        }
+    }
+    return true;
+}
+
+
+// Título: câmera parada, "PRESS START" piscando.
+void update_title() {
+    if ((title_timer & (TITLE_BLINK_MASK - 1)) == 0) {
+        vrambuf_put(NTADR_A(MSG_X, MSG_Y),
+                    (title_timer & TITLE_BLINK_MASK) ? MSG_BLANK : MSG_PRESS_START,
+                    MSG_LEN);
+    }
+    title_timer++;
+    level_start_seed++;
+
+    if (pad_trigger(0) & PAD_START) {
+        set_game_state(STATE_PLAY);
+    }
+}
+
+
+// Jogo em andamento.
+void update_play() {
+    bool wrapped, crashed;
+
+    // Atualiza a posição da câmera e dispara os eventos da fase
+    wrapped = update_scroll();
+#if CHECK_INVARIANTS
+    if (wrapped) {
+        check_tower_cycle();
+    }
+#endif
+    timeline_update(wrapped);
+    update_parallax();   // Agenda os splits das camadas para o próximo quadro
+
+    // Atualiza a lógica da física do dragão (movimento)
+    update_dragon_physics();
+  
+    // Desenha a próxima coluna da torre em andamento
+    update_towers();
+
+    // Bater numa torre ou encostar no chão termina o jogo, sem ponto neste
+    // quadro. A pontuação também vai para a nametable, então entra no
+    // buffer da VRAM antes dos tiles da animação (chrstream.h)
+    crashed = dragon_hits_tower() || dragon.y_pos >= DRAGON_MAX_Y;
+    if (!crashed) {
+        update_score();
+    }
+
+    // Envia os tiles da animação com o espaço que sobrou no buffer da VRAM
+    update_dragon_animation();
+
+    // Desenha todos os sprites na tela
+    draw_sprites();
+
+    if (crashed) {
+        audio_sfx(SFX_CRASH);
+        set_game_state(STATE_GAMEOVER);
+    }
+}
+
+
+// Fim de jogo: tela congelada até START, depois limpa as torres e recomeça.
+void update_gameover() {
+    level_start_seed++;
+
+    // Recomeço: a tela continua congelada enquanto as torres são apagadas.
+    // A entrada no jogo espera o quadro seguinte se as últimas colunas
+    // apagadas não deixaram espaço para ela no buffer da VRAM
+    if (restart_requested) {
+        if (clear_dirty_towers() && VRAMBUF_ROOM(PLAY_ENTRY_BYTES)) {
+            set_game_state(STATE_PLAY);
+        }
+        return;
+    }
+
+    if (gameover_timer < GAMEOVER_MIN_FRAMES) {
+        gameover_timer++;
+    }
 
-    // Esconde todos os outros slots de sprite não utilizados para evitar "sprites fantasmas"
-    oam_hide_rest(oam_id); 
+    if ((pad_trigger(0) & PAD_START) && gameover_timer >= GAMEOVER_MIN_FRAMES) {
+        restart_requested = true;
+    }
+}
+
+
+//--------------------------------------------------------//
+//                 MEDIÇÃO DO ÁUDIO                       //
+//--------------------------------------------------------//
+
+#define AUDIO_CALIBRATE 0       // 1 = mede o custo do famitone_update ao ligar
+
+#if AUDIO_CALIBRATE
+
+#define CALIBRATE_FRAMES 128
+
+// Quadros alternados com e sem o famitone_update no NMI, com o buffer da
+// VRAM vazio e os efeitos tocando. A diferença entre as menores folgas
+// até o sprite zero dos dois tipos de quadro é o custo do áudio, que vai
+// para dbg.audio_cycles (comparar com AUDIO_UPDATE_CYCLES em audio.h).
+// A menor folga sem áudio é a janela real que sobra para o flush e o
+// áudio; as duas medidas substituem as estimativas de audio.h.
+void calibrate_audio() {
+    word slack;
+    word slack_quiet = 0xFFFF;
+    word slack_audio = 0xFFFF;
+    word free_cycles;
+    byte i;
+
+    for (i = 0; i < CALIBRATE_FRAMES; i++) {
+        if ((i & 31) == 0) {
+            audio_sfx(SFX_CRASH);
+            audio_sfx(SFX_SCORE);
+        }
+        audio_nmi_pending = i & 1;
+
+        ppu_wait_nmi();
+        vrambuf_clear();
+        slack = raster_wait_sprite0(scroll_x);
+
+        if (i & 1) {
+            if (slack < slack_audio) slack_audio = slack;
+        } else {
+            if (slack < slack_quiet) slack_quiet = slack;
+        }
+    }
+    audio_nmi_done = 0;
+    dbg.audio_cycles = (slack_quiet - slack_audio) * RASTER_POLL_CYCLES;
+
+    free_cycles = slack_quiet * RASTER_POLL_CYCLES;
+    free_cycles = (free_cycles > NMI_MARGIN_CYCLES) ? free_cycles - NMI_MARGIN_CYCLES : 0;
+    audio_set_budget(free_cycles, dbg.audio_cycles);
+}
+
+#endif
+
+
+//--------------------------------------------------------//
+//            TESTE DAS ROTINAS EM ASSEMBLY               //
+//--------------------------------------------------------//
+
+#if HOTPATH_SELFTEST
+
+#define SELFTEST_RANDOM 1024    // Estados sorteados da física e do scroll
+
+// Mede uma chamada pela porta de teste (ciclos no tools/nes_trace)
+#define MEASURE(id, call) { test_port(TEST_BEGIN + (id)); call; test_port(TEST_END); }
+
+void hotpath_fail(byte id) {
+    test_port(TEST_FAIL + id);
+    ++dbg.hotpath_errors;
+}
+
+// Compara as versões em C e em assembly (hotpath.s): todas as colunas e
+// gaps de torre, todos os endereços das nametables A e B, e estados
+// sorteados (sem restrição de faixa) da física do dragão e do scroll.
+// Cada chamada é medida pela porta de teste; o tools/nes_trace imprime a
+// tabela de ciclos C x assembly e conta as divergências, que também vão
+// para dbg.hotpath_errors. Roda antes do jogo, que reinicia tudo o que
+// foi alterado aqui.
+void hotpath_selftest() {
+    static Dragon start, after;
+    static byte column_c[TOWER_HEIGHT], column_asm[TOWER_HEIGHT];
+    static word addr, attr_c, attr_asm;
+    static byte column, gap, jump;
+    static bool wrapped_c, wrapped_asm;
+    static int sub, sub_c;
+    static word scroll_c;
+    word i;
+
+    set_rand(1);
+
+    for (i = 0; i < SELFTEST_RANDOM; i++) {
+        start.x_pos = rand8();
+        start.y_pos = rand8();
+        start.y_vel = rand16();
+        start.y_pos_subpixel = rand16();
+        jump = rand8() & 1;
+
+        dragon = start;
+        MEASURE(HOTPATH_PHYSICS, dragon_physics_step_c(jump));
+        after = dragon;
+        dragon = start;
+        MEASURE(HOTPATH_PHYSICS + 1, dragon_physics_step_asm(jump));
+        if (memcmp(&dragon, &after, sizeof(Dragon))) hotpath_fail(HOTPATH_PHYSICS);
+
+        sub = rand16();
+        scroll_speed = rand8();
+        scroll_x_subpixel = sub;
+        MEASURE(HOTPATH_SCROLL, wrapped_c = update_scroll_c());
+        sub_c = scroll_x_subpixel;
+        scroll_c = scroll_x;
+        scroll_x_subpixel = sub;
+        MEASURE(HOTPATH_SCROLL + 1, wrapped_asm = update_scroll_asm());
+        if (wrapped_asm != wrapped_c || scroll_x_subpixel != sub_c || scroll_x != scroll_c) {
+            hotpath_fail(HOTPATH_SCROLL);
+        }
+    }
+
+    for (column = 0; column < TOWER_COLUMNS; column++) {
+        for (gap = 0; gap <= TOWER_HEIGHT; gap++) {
+            MEASURE(HOTPATH_COLUMN, fill_tower_column_c(column_c, column, gap));
+            MEASURE(HOTPATH_COLUMN + 1, fill_tower_column_asm(column_asm, column, gap));
+            if (memcmp(column_c, column_asm, TOWER_HEIGHT)) hotpath_fail(HOTPATH_COLUMN);
+        }
+    }
+
+    for (addr = NAMETABLE_A; addr < NAMETABLE_A + 0x800; addr++) {
+        MEASURE(HOTPATH_ATTR, attr_c = nametable_to_attribute_addr_c(addr));
+        MEASURE(HOTPATH_ATTR + 1, attr_asm = nametable_to_attribute_addr_asm(addr));
+        if (attr_asm != attr_c) hotpath_fail(HOTPATH_ATTR);
+    }
+
+    test_port(TEST_DONE);
+}
+
+#endif
+
+
+//--------------------------------------------------------//
+//                     INVARIANTES                        //
+//--------------------------------------------------------//
+
+#if CHECK_INVARIANTS
+
+// Conferidas a cada quadro, com o buffer da VRAM completo. Cada violação
+// soma em dbg.invariant_errors, fica em dbg.invariant_last e sai pela
+// porta de teste (TEST_FAIL + TEST_INVARIANT + n), que o tools/nes_trace
+// conta com o quadro da primeira ocorrência; com --random ele joga
+// sozinho por quantos quadros for preciso. O tools/fuzz_logic.c roda a
+// mesma lógica no host, guiado por cobertura.
+#define CHECK_VRAM_ADDR   0     // Registro do buffer fora das nametables A/B e da CHR-RAM
+#define CHECK_VRAM_SIZE   1     // updptr além de VRAMBUF_FRAME_MAX, sem EOF ou fora do fim dos registros
+#define CHECK_TOWER_CYCLE 2     // Torre não redesenhada exatamente uma vez na volta do scroll
+#define CHECK_DRAGON_Y    3     // Dragão fora de DRAGON_MIN_Y..DRAGON_MAX_Y
+#define CHECK_SCROLL      4     // scroll_x fora de 0-511
+
+void check_fail(byte id) {
+    test_port(TEST_FAIL + TEST_INVARIANT + id);
+    ++dbg.invariant_errors;
+    dbg.invariant_last = id;
+}
+
+
+// Percorre os registros do buffer no formato da neslib. Uma sequência
+// horizontal fica dentro da sua nametable (atributos incluídos); uma
+// vertical não chega aos atributos; os tiles do chr_stream ficam abaixo
+// de $2000.
+void check_vram_buffer() {
+    word i = 0;                 // word: um len corrompido não dá a volta
+    byte hi, len;
+    word addr, end;
+
+    if (updptr > VRAMBUF_FRAME_MAX || updbuf[updptr] != NT_UPD_EOF) {
+        check_fail(CHECK_VRAM_SIZE);
+        return;
+    }
+
+    while (i < updptr) {
+        hi = updbuf[i];
+        addr = ((word)(hi & 0x3F) << 8) | updbuf[i + 1];
+        if (hi >= NT_UPD_HORZ) {
+            len = updbuf[i + 2];
+            i += 3 + len;
+        } else {
+            len = 1;
+            i += 3;
+        }
+        if (!len) {
+            check_fail(CHECK_VRAM_ADDR);
+            continue;
+        }
+
+        if (hi >= NT_UPD_VERT) {
+            end = addr + ((word)(len - 1) << 5);
+        } else {
+            end = addr + len - 1;
+        }
+
+        if (addr < NAMETABLE_A) {
+            if (end >= NAMETABLE_A) check_fail(CHECK_VRAM_ADDR);
+        } else if (end >= NAMETABLE_C || ((addr ^ end) & 0xFC00)) {
+            check_fail(CHECK_VRAM_ADDR);
+        } else if (hi >= NT_UPD_VERT && (end & 0x3FF) >= 0x3C0) {
+            check_fail(CHECK_VRAM_ADDR);
+        }
+    }
+
+    if (i != updptr) {
+        check_fail(CHECK_VRAM_SIZE);
+    }
+}
+
+
+// Na volta do scroll (antes dos eventos da volta nova): cada torre foi
+// desenhada até o fim uma única vez. Uma torre recomeçada antes de
+// terminar, ou disparada duas vezes, aparece aqui.
+void check_tower_cycle() {
+    byte i;
+
+    for (i = 0; i < NUM_TOWERS; i++) {
+        if (check_tower_draws[i] != 1) {
+            check_fail(CHECK_TOWER_CYCLE);
+        }
+        check_tower_draws[i] = 0;
+    }
+}
+
+
+void check_invariants() {
+    check_vram_buffer();
+
+    // O overlay do jogo só vale em STATE_PLAY
+    if (game_state != STATE_PLAY) {
+        return;
+    }
+    if (dragon.y_pos < DRAGON_MIN_Y || dragon.y_pos > DRAGON_MAX_Y) {
+        check_fail(CHECK_DRAGON_Y);
+    }
+    if (scroll_x >= 512) {
+        check_fail(CHECK_SCROLL);
+    }
+}
+
+#endif
+
+
+// A lógica de um quadro, depois do split do sprite zero: o estado atual
+// e, com o buffer da VRAM completo, o agendamento do áudio e as
+// invariantes. O tools/fuzz_logic.c chama esta função no host.
+void update_frame() {
+    switch (game_state) {
+        case STATE_TITLE:    update_title();    break;
+        case STATE_PLAY:     update_play();     break;
+        case STATE_GAMEOVER: update_gameover(); break;
+    }
+
+    // Com o buffer da VRAM completo, decide onde roda o próximo áudio
+    audio_schedule();
+
+#if CHECK_INVARIANTS
+    check_invariants();
+#endif
 }
 
 
+#pragma rodata-name (pop)
+#pragma code-name (pop)
+
+
 //--------------------------------------------------------//
 //                 LOOP PRINCIPAL DO JOGO                 //
 //--------------------------------------------------------//
 
+// Em CODE (banco 7): roda antes do mmc3_init() fixar o banco 6 em $C000
 void main(void)
 {
+    mmc3_init();          // Configura os bancos de PRG/CHR do mapper
+
+#if HOTPATH_SELFTEST
+    hotpath_selftest();   // Compara as rotinas em C e em assembly (dbg.hotpath_errors)
+#endif
+
     setup_graphics();     // Executa a configuração inicial dos gráficos
   
     setup_sprite_zero();  // Configura o sprite zero uma vez, na inicialização.
@@ -464,28 +1557,34 @@ void main(void)
     vrambuf_clear();          // Limpa o VRAM buffer
     set_vram_update(updbuf);  // Vincula VRAM update buffer
 
-    initialize_dragon();  // Define a posição inicial do dragão
-  
-    initialize_towers();  // Define as variáveis iniciais das torres
+    initialize_scroll();      // Câmera no início da nametable A
+    audio_init();             // FamiTone parada, efeitos prontos
+    raster_init();            // Instala o callback de NMI/IRQ dos splits (e do áudio)
+
+    set_game_state(STATE_TITLE);  // Começa na tela de título
   
     ppu_on_all();    // Ativa a renderização da PPU para mostrar os gráficos na tela
 
+#if AUDIO_CALIBRATE
+    calibrate_audio();
+#endif
+
     // Loop infinito que executa o jogo
     while(1) {
         ppu_wait_nmi();   // wait for NMI to ensure previous frame finished
+        idle_begin();     // Marca o quadro para o prazo das tarefas de fundo
         vrambuf_clear();  // Clear VRAM buffer each frame immediately after NMI
       
-        split(scroll_x, 0);  // Ela espera pelo sprite zero e atualiza o scroll horizontal
-      
-        update_scroll();     // Atualiza a posição da câmera
+        // Espera pelo sprite zero e atualiza o scroll horizontal (como split()),
+        // medindo a folga que o NMI deixou até essa linha
+        dbg_split_slack(raster_wait_sprite0(scroll_x));
 
-        // Atualiza a lógica da física do dragão (movimento)
-        update_dragon_physics();
-      
-        // Atualiza a lógica das torres
-        update_towers(scroll_x);
+        // Se o NMI deste quadro não atualizou o áudio, atualiza agora
+        audio_update_deferred();
+
+        update_frame();
 
-        // Desenha todos os sprites na tela
-        draw_sprites();
+        // O resto do quadro, até o prazo do raster, vai para as tarefas de fundo
+        idle_run(idle_tasks, IDLE_TASKS);
     }
 }
@@ -0,0 +1,52 @@
+
+#ifndef _HOTPATH_H
+#define _HOTPATH_H
+
+#include "neslib.h"
+
+// Versões em assembly (hotpath.s) das rotinas que rodam a cada quadro ou
+// a cada coluna de torre. As versões em C de dragons_leap.c continuam como
+// referência: HOTPATH_ASM escolhe qual é usada e HOTPATH_SELFTEST compara
+// as duas ao ligar (ver dragons_leap.c).
+//
+// Os nomes e a assinatura são os mesmos das versões em C, com o sufixo _asm;
+// as constantes de physics.h e das torres estão repetidas em hotpath.s.
+
+// Um quadro de DRAGON_PHYSICS_STEP(dragon, jump)
+void __fastcall__ dragon_physics_step_asm(byte jump);
+
+// fill_tower_column(): 22 tiles da coluna "column" (0-3) com o gap
+void __fastcall__ fill_tower_column_asm(byte* buffer, byte column, byte gap_start);
+
+// nametable_to_attribute_addr(): byte de atributos do tile em "a"
+word __fastcall__ nametable_to_attribute_addr_asm(word a);
+
+// update_scroll(): avança a câmera; true quando dá a volta nos 512 pixels
+bool update_scroll_asm(void);
+
+
+// Porta de teste: escritas aqui não fazem nada no NES (não há nada
+// mapeado em $5FFF com o MMC3), mas o tools/nes_trace.c as interpreta para
+// medir ciclos e contar divergências do HOTPATH_SELFTEST.
+#define TEST_PORT     0x5FFF
+#define TEST_BEGIN    0x00    // + n: começa a medir a rotina n (0-31)
+#define TEST_END      0x40    // termina a medição em andamento
+#define TEST_FAIL     0x80    // + n: a rotina n divergiu da referência
+#define TEST_DONE     0xFF    // fim do teste
+
+// (o build do host em tools/fuzz_logic.c define a sua antes)
+#ifndef test_port
+#define test_port(v) (*(byte*)TEST_PORT = (v))
+#endif
+
+// Rotinas medidas: a versão em C é 2n e a versão em assembly 2n+1
+#define HOTPATH_PHYSICS 0
+#define HOTPATH_COLUMN  2
+#define HOTPATH_ATTR    4
+#define HOTPATH_SCROLL  6
+
+// TEST_FAIL + TEST_INVARIANT + n: a invariante n do jogo foi violada
+// (CHECK_INVARIANTS em dragons_leap.c)
+#define TEST_INVARIANT  16
+
+#endif // hotpath.h
@@ -0,0 +1,256 @@
+
+; Versões em assembly das rotinas quentes do jogo (ver hotpath.h).
+; As versões em C de dragons_leap.c são a referência; o HOTPATH_SELFTEST
+; compara as duas ao ligar.
+;
+; Ciclos com o rts e sem o jsr de quem chama, medidos no núcleo de CPU do
+; tools/nes_trace, mínimo-máximo nas entradas do HOTPATH_SELFTEST (os das
+; versões em C saem da tabela que o nes_trace imprime com HOTPATH_SELFTEST=1):
+;   dragon_physics_step_asm          90-146 (99 no quadro comum: caindo,
+;                                    sem pulo nem limite)
+;   fill_tower_column_asm            405-476 (inclui o incsp3)
+;   nametable_to_attribute_addr_asm  64
+;   update_scroll_asm                82, 95 no quadro em que dá a volta
+; Tudo fica no banco fixo (segmento CODE).
+
+	.export _dragon_physics_step_asm
+	.export _fill_tower_column_asm
+	.export _nametable_to_attribute_addr_asm
+	.export _update_scroll_asm
+
+	.importzp sp, ptr1, tmp1, tmp2
+	.import incsp3
+	.importzp _dragon, _scroll_x, _scroll_x_subpixel
+	.import _scroll_speed
+
+; Campos do struct Dragon (dragons_leap.c, DRAGON_ZP_SIZE bytes)
+DRAGON_Y   = _dragon+1		; byte
+DRAGON_VEL = _dragon+2		; int
+DRAGON_SUB = _dragon+4		; int
+
+; Mesmos valores de physics.h
+SUBPIXEL_SHIFT   = 4
+DRAGON_MIN_Y     = 28
+DRAGON_MAX_Y     = 194
+GRAVITY          = 4
+MAX_GRAVITY      = 80
+JUMP_SPEED       = -64
+TOWER_HEIGHT     = 22
+TOWER_GAP_HEIGHT = 6
+
+; Mesmos valores de dragons_leap.c
+TILE_TOP_LEFT  = $88
+TILE_TOP_MID   = $89
+TILE_TOP_RIGHT = $8A
+TILE_BOT_LEFT  = $A8		; cada tile de baixo fica $20 depois do de cima
+
+.segment "CODE"
+
+; void __fastcall__ dragon_physics_step_asm(byte jump)
+_dragon_physics_step_asm:
+	tax			; 2
+	beq @gravity		; 3
+	lda #<JUMP_SPEED	; 2   pulo: y_vel = JUMP_SPEED
+	sta DRAGON_VEL		; 3
+	lda #>JUMP_SPEED	; 2
+	sta DRAGON_VEL+1	; 3
+@gravity:
+	clc			; 2   y_vel += GRAVITY
+	lda DRAGON_VEL		; 3
+	adc #GRAVITY		; 2
+	sta DRAGON_VEL		; 3
+	lda DRAGON_VEL+1	; 3
+	adc #0			; 2
+	sta DRAGON_VEL+1	; 3
+	bmi @move		; 2   negativa: não passa do limite
+	bne @clamp_vel		; 2   >= 256
+	lda DRAGON_VEL		; 3
+	cmp #MAX_GRAVITY+1	; 2
+	bcc @move		; 3
+@clamp_vel:
+	lda #MAX_GRAVITY	; 2   y_vel = MAX_GRAVITY
+	sta DRAGON_VEL		; 3
+	lda #0			; 2
+	sta DRAGON_VEL+1	; 3
+@move:
+	clc			; 2   y_pos_subpixel += y_vel
+	lda DRAGON_SUB		; 3
+	adc DRAGON_VEL		; 3
+	sta DRAGON_SUB		; 3
+	lda DRAGON_SUB+1	; 3
+	adc DRAGON_VEL+1	; 3
+	sta DRAGON_SUB+1	; 3
+	asl			; 8   y_pos = byte baixo de (y_pos_subpixel >> 4)
+	asl
+	asl
+	asl
+	sta DRAGON_Y		; 3
+	lda DRAGON_SUB		; 3
+	lsr			; 8
+	lsr
+	lsr
+	lsr
+	ora DRAGON_Y		; 3
+	sta DRAGON_Y		; 3
+	cmp #DRAGON_MIN_Y	; 2   teto
+	bcs @floor		; 3
+	lda #DRAGON_MIN_Y	; 2
+	bne @clamp_y		; 3   sempre
+@floor:
+	cmp #DRAGON_MAX_Y+1	; 2   chão
+	bcc @done		; 3
+	lda #DRAGON_MAX_Y	; 2
+@clamp_y:
+	sta DRAGON_Y		; 3   y_pos_subpixel = y_pos << 4, y_vel = 0
+	tax			; 2
+	asl			; 8
+	asl
+	asl
+	asl
+	sta DRAGON_SUB		; 3
+	txa			; 2
+	lsr			; 8
+	lsr
+	lsr
+	lsr
+	sta DRAGON_SUB+1	; 3
+	lda #0			; 2
+	sta DRAGON_VEL		; 3
+	sta DRAGON_VEL+1	; 3
+@done:
+	rts			; 6
+
+; void __fastcall__ fill_tower_column_asm(byte* buffer, byte column, byte gap_start)
+; A = gap_start; na pilha do C: column em (sp),0 e buffer em (sp),1-2.
+; Preenche de baixo para cima: base, gap e topo, cada parte num laço curto.
+_fill_tower_column_asm:
+	cmp #TOWER_HEIGHT	; 2   tmp1 = fim do topo = min(gap_start, TOWER_HEIGHT)
+	bcc :+			; 3
+	lda #TOWER_HEIGHT	; 2
+:	sta tmp1		; 3
+	clc			; 2   tmp2 = fim do gap = min(tmp1 + TOWER_GAP_HEIGHT, TOWER_HEIGHT)
+	adc #TOWER_GAP_HEIGHT	; 2
+	cmp #TOWER_HEIGHT	; 2
+	bcc :+			; 3
+	lda #TOWER_HEIGHT	; 2
+:	sta tmp2		; 3
+	ldy #2			; 2   ptr1 = buffer
+	lda (sp),y		; 5
+	sta ptr1+1		; 3
+	dey			; 2
+	lda (sp),y		; 5
+	sta ptr1		; 3
+	dey			; 2
+	lda (sp),y		; 5   column: 0 = L, 3 = R, outra = M
+	ldx #TILE_TOP_LEFT	; 2
+	cmp #0			; 2   o ldx mexeu no Z
+	beq @tiles		; 3
+	ldx #TILE_TOP_RIGHT	; 2
+	cmp #3			; 2
+	beq @tiles		; 3
+	ldx #TILE_TOP_MID	; 2
+@tiles:
+	txa			; 2   X = tile de cima, A = tile de baixo
+	clc			; 2
+	adc #TILE_BOT_LEFT-TILE_TOP_LEFT ; 2
+	ldy #TOWER_HEIGHT	; 2
+@bottom:
+	cpy tmp2		; 3   16 por tile
+	beq @gap		; 2
+	dey			; 2
+	sta (ptr1),y		; 6
+	bcs @bottom		; 3   sempre (C = 1 do cpy)
+@gap:
+	lda #0			; 2
+@gap_loop:
+	cpy tmp1		; 3   16 por tile
+	beq @top		; 2
+	dey			; 2
+	sta (ptr1),y		; 6
+	bcs @gap_loop		; 3   sempre
+@top:
+	txa			; 2
+@top_loop:
+	dey			; 2   13 por tile
+	bmi @done		; 2
+	sta (ptr1),y		; 6
+	bpl @top_loop		; 3   sempre
+@done:
+	jmp incsp3		; 3   descarta column e buffer
+
+; word __fastcall__ nametable_to_attribute_addr_asm(word a)
+; A/X = endereço na nametable; devolve o endereço dos atributos em A/X:
+; (a & $2C00) | $03C0 | ((a >> 4) & $38) | ((a >> 2) & $07)
+_nametable_to_attribute_addr_asm:
+	sta tmp1		; 3
+	txa			; 2   bits 9-8 de a -> bits 5-4
+	asl			; 8
+	asl
+	asl
+	asl
+	and #$30		; 2
+	sta tmp2		; 3
+	txa			; 2   byte alto: nametable | $03
+	and #$2C		; 2
+	ora #$03		; 2
+	tax			; 2
+	lda tmp1		; 3
+	lsr			; 4
+	lsr
+	sta tmp1		; 3   a >> 2: bit 5 = bit 7 de a, bits 2-0 = coluna
+	lsr			; 4
+	lsr
+	and #$08		; 2   bit 7 de a -> bit 3
+	ora tmp2		; 3
+	sta tmp2		; 3
+	lda tmp1		; 3
+	and #$07		; 2
+	ora tmp2		; 3
+	ora #$C0		; 2
+	rts			; 6
+
+; bool update_scroll_asm(void)
+_update_scroll_asm:
+	clc			; 2   scroll_x_subpixel += scroll_speed
+	lda _scroll_x_subpixel	; 3
+	adc _scroll_speed	; 4
+	sta _scroll_x_subpixel	; 3
+	lda _scroll_x_subpixel+1 ; 3
+	adc #0			; 2
+	sta _scroll_x_subpixel+1 ; 3
+	tax			; 2   scroll_x = scroll_x_subpixel >> 4 (com sinal)
+	asl			; 8
+	asl
+	asl
+	asl
+	sta _scroll_x		; 3
+	lda _scroll_x_subpixel	; 3
+	lsr			; 8
+	lsr
+	lsr
+	lsr
+	ora _scroll_x		; 3
+	sta _scroll_x		; 3
+	txa			; 2
+	lsr			; 8
+	lsr
+	lsr
+	lsr
+	cpx #$80		; 2
+	bcc :+			; 3
+	ora #$F0		; 2
+:	sta _scroll_x+1		; 3
+	cmp #>512		; 2   scroll_x >= 512?
+	bcs @wrap		; 2
+	lda #0			; 2   false
+	tax			; 2
+	rts			; 6
+@wrap:
+	sbc #>512		; 2   C = 1: scroll_x -= 512
+	sta _scroll_x+1		; 3
+	txa			; 2   scroll_x_subpixel -= 512 << 4 (C continua 1)
+	sbc #>(512 << SUBPIXEL_SHIFT) ; 2
+	sta _scroll_x_subpixel+1 ; 3
+	lda #1			; 2   true
+	ldx #0			; 2
+	rts			; 6
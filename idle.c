@@ -0,0 +1,35 @@
+
+#include "neslib.h"
+#include "idle.h"
+#include "raster.h"
+#include "debug.h"
+
+static byte idle_frame;         // nesclock() do início do quadro
+
+void idle_begin(void) {
+  idle_frame = nesclock();
+}
+
+void idle_run(const IdleTask* tasks, byte count) {
+  byte i = 0;
+  byte empty = 0;               // tarefas seguidas sem trabalho
+  byte steps = 0;
+
+  while (empty < count) {
+    if (raster_late || nesclock() != idle_frame) {
+      // ainda havia trabalho
+      ++dbg.idle_cut;
+      break;
+    }
+    if (tasks[i]()) {
+      ++steps;
+      empty = 0;
+    } else {
+      ++empty;
+    }
+    if (++i == count) {
+      i = 0;
+    }
+  }
+  dbg.idle_steps = steps;
+}
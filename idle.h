@@ -0,0 +1,29 @@
+
+#ifndef _IDLE_H
+#define _IDLE_H
+
+#include "neslib.h"
+
+// Tarefas de baixa prioridade no tempo que sobra do quadro, depois da
+// lógica do jogo e antes do ppu_wait_nmi(). Cada tarefa faz um passo curto
+// e devolve false quando não tem nada a fazer; o estado fica nas variáveis
+// dela, então o trabalho continua no quadro seguinte de onde parou.
+//
+// idle_run() chama as tarefas em rodízio até todas ficarem sem trabalho
+// ou o quadro acabar: a IRQ do prazo já ligou raster_late (raster.h), ou
+// o NMI já veio (nesclock() mudou desde idle_begin()).
+// As tarefas não podem usar o buffer da VRAM: o audio_schedule() já
+// estimou o NMI com o tamanho dele.
+
+// Pior caso de um passo: cabe entre RASTER_DEADLINE_LINE e o vblank
+#define IDLE_STEP_CYCLES 600
+
+typedef bool (*IdleTask)(void);
+
+// Início do quadro: chamar logo depois do ppu_wait_nmi()
+void idle_begin(void);
+
+// Roda as "count" tarefas de "tasks" até o prazo
+void idle_run(const IdleTask* tasks, byte count);
+
+#endif // idle.h
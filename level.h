@@ -0,0 +1,22 @@
+
+#ifndef _LEVEL_H
+#define _LEVEL_H
+
+// Geração da sequência de gaps das torres, compartilhada entre o jogo e
+// tools/reach_solver.c. Cada partida começa de uma semente de 16 bits
+// diferente de zero; a k-ésima torre desenhada recebe o k-ésimo gap.
+
+#define LEVEL_GAP_MIN  3        // Gap mais alto (tile)
+#define LEVEL_GAP_MASK 7        // Gaps de LEVEL_GAP_MIN até LEVEL_GAP_MIN + 7
+
+// Avança a semente "s" (16 bits sem sinal): xorshift (7, 9, 8)
+#define LEVEL_NEXT_SEED(s) {\
+    (s) ^= (s) << 7;\
+    (s) ^= (s) >> 9;\
+    (s) ^= (s) << 8;\
+}
+
+// Gap da semente atual (bits altos, que se misturam melhor)
+#define LEVEL_GAP(s) (LEVEL_GAP_MIN + (((s) >> 8) & LEVEL_GAP_MASK))
+
+#endif // level.h
@@ -0,0 +1,61 @@
+
+#ifndef _MMC3_H
+#define _MMC3_H
+
+#include "neslib.h"
+#include <peekpoke.h>
+
+// Mapa de bancos de PRG (MMC3, modo 0, bancos de 8 KB):
+//   $8000-$9FFF  banco selecionável (R6)  -> BANK0..BANK5 e CHARS (banco 1)
+//   $A000-$BFFF  banco selecionável (R7)  -> 1 pelo mmc3_init, sem uso: nada
+//                                            é ligado em $A000, e o CHARS é
+//                                            lido por $8000 (R6 = BANK_CHR)
+//   $C000-$DFFF  banco 6, fixo no modo 0  -> GAMECODE, GAMEDATA
+//   $E000-$FFFF  banco 7, fixo sempre     -> STARTUP, CODE, RODATA, neslib,
+//                                            mmc3_init, main, vetores
+// O modo de PRG é indefinido no reset: $C000 só vale o banco 6 depois do
+// mmc3_init(), que por isso fica no banco 7 junto com tudo que roda antes.
+#define PRG_BANK_COUNT   8
+#define PRG_BANK_FIXED   6              // primeiro banco fixo ($C000)
+
+// Registradores do MMC3
+#define MMC3_BANK_SELECT  0x8000
+#define MMC3_BANK_DATA    0x8001
+#define MMC3_MIRRORING    0xA000
+#define MMC3_PRG_RAM      0xA001
+#define MMC3_IRQ_LATCH    0xC000
+#define MMC3_IRQ_RELOAD   0xC001
+#define MMC3_IRQ_DISABLE  0xE000
+#define MMC3_IRQ_ENABLE   0xE001
+
+#define MMC_MODE 0x00                   // PRG modo 0, CHR modo 0
+
+#define MMC3_SET_REG(r,n)\
+  POKE(MMC3_BANK_SELECT, MMC_MODE|(r));\
+  POKE(MMC3_BANK_DATA, (n));
+
+#define MMC3_CHR_0000(n) MMC3_SET_REG(0,n)   // 2 KB
+#define MMC3_CHR_0800(n) MMC3_SET_REG(1,n)   // 2 KB
+#define MMC3_CHR_1000(n) MMC3_SET_REG(2,n)   // 1 KB
+#define MMC3_CHR_1400(n) MMC3_SET_REG(3,n)   // 1 KB
+#define MMC3_CHR_1800(n) MMC3_SET_REG(4,n)   // 1 KB
+#define MMC3_CHR_1C00(n) MMC3_SET_REG(5,n)   // 1 KB
+#define MMC3_PRG_A000(n) MMC3_SET_REG(7,n)
+
+#define MMC3_MIRROR(n) POKE(MMC3_MIRRORING, (n))   // 0 = vertical, 1 = horizontal
+
+// banco atualmente mapeado em $8000 (sombra do R6)
+extern byte mmc3_prg_bank;
+
+// troca o banco em $8000 (preserva X)
+void __fastcall__ mmc3_set_prg_8000(byte bank);
+
+// estado inicial do mapper: bancos de CHR lineares, PRG 0/1, IRQ desligada
+void mmc3_init(void);
+
+// Trampolim do banco fixo para funções em bancos selecionáveis.
+// Usado com: #pragma wrapped-call (push, bank_trampoline, <banco>)
+// O cc65 passa o endereço da função em ptr4 e o banco em tmp4.
+void bank_trampoline(void);
+
+#endif // mmc3.h
@@ -0,0 +1,82 @@
+
+; Suporte ao mapper MMC3: troca de bancos de PRG e trampolim
+; para chamadas de C em bancos selecionáveis.
+; Tudo aqui fica no banco 7 (segmento CODE, em $E000): o mmc3_init roda
+; antes de o modo 0 fixar o banco 6 em $C000.
+
+	.importzp ptr4, tmp4
+
+	.export _mmc3_prg_bank
+	.export _mmc3_set_prg_8000
+	.export _mmc3_init
+	.export _bank_trampoline
+
+MMC3_BANK_SELECT = $8000
+MMC3_BANK_DATA   = $8001
+MMC3_MIRRORING   = $A000
+MMC3_PRG_RAM     = $A001
+MMC3_IRQ_DISABLE = $E000
+
+MMC_MODE = $00
+
+.segment "BSS"
+
+_mmc3_prg_bank:	.res 1		; sombra do R6 ($8000)
+tramp_a:	.res 1		; A salvo durante a troca
+
+.segment "CODE"
+
+; void __fastcall__ mmc3_set_prg_8000(byte bank)
+; Só usa A, para poder ser chamado pelo trampolim sem perder X.
+_mmc3_set_prg_8000:
+	sta _mmc3_prg_bank
+	lda #MMC_MODE|6
+	sta MMC3_BANK_SELECT
+	lda _mmc3_prg_bank
+	sta MMC3_BANK_DATA
+	rts
+
+; void mmc3_init(void)
+_mmc3_init:
+	ldx #0
+@loop:
+	lda #MMC_MODE
+	ora chr_regs,x
+	sta MMC3_BANK_SELECT
+	lda chr_banks,x
+	sta MMC3_BANK_DATA
+	inx
+	cpx #8
+	bne @loop
+	lda #0
+	sta _mmc3_prg_bank
+	sta MMC3_MIRRORING	; mirroring vertical (scroll horizontal)
+	sta MMC3_IRQ_DISABLE
+	lda #$80
+	sta MMC3_PRG_RAM	; PRG-RAM habilitada, sem proteção
+	rts
+
+; R0..R5 com CHR linear (2K,2K,1K,1K,1K,1K), R6 = banco 0, R7 = banco 1
+chr_regs:	.byte 0, 1, 2, 3, 4, 5, 6, 7
+chr_banks:	.byte 0, 2, 4, 5, 6, 7, 0, 1
+
+; Trampolim para #pragma wrapped-call.
+; Entrada: ptr4 = função, tmp4 = banco, A/X = argumento fastcall.
+; Salva o banco atual, chama a função e restaura o banco,
+; preservando o retorno em A/X.
+_bank_trampoline:
+	sta tramp_a
+	lda _mmc3_prg_bank
+	pha
+	lda tmp4
+	jsr _mmc3_set_prg_8000
+	lda tramp_a
+	jsr call_ptr4
+	sta tramp_a
+	pla
+	jsr _mmc3_set_prg_8000
+	lda tramp_a
+	rts
+
+call_ptr4:
+	jmp (ptr4)
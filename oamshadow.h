@@ -0,0 +1,32 @@
+
+#ifndef _OAMSHADOW_H
+#define _OAMSHADOW_H
+
+#include "neslib.h"
+
+// Escrita na OAM com controle de alterações.
+// O próprio buffer da OAM ($200) serve de sombra: ele é enviado inteiro
+// por DMA a cada NMI, mas só os bytes que mudaram são reescritos pela CPU,
+// e só os slots usados no quadro anterior são escondidos.
+// Em assembly (oamshadow.s): a comparação em C custava mais que as
+// escritas cegas do oam_meta_spr que ela evitava.
+
+// Primeiro slot livre (o slot 0 é o sprite zero do split)
+#define OAM_FIRST_FREE 4
+
+// Y usado para esconder um sprite
+#define OAM_HIDDEN_Y 0xF0
+
+// Esquece o quadro anterior; chamar depois de oam_clear()
+void oam_shadow_reset(void);
+
+// Começa um quadro a partir de OAM_FIRST_FREE
+void oam_shadow_begin(void);
+
+// Mesmo formato de oam_meta_spr(): {dx, dy, tile, attr}..., 128
+void __fastcall__ oam_shadow_meta(byte x, byte y, const byte* data);
+
+// Esconde o que sobrou do quadro anterior e publica dbg.oam_bytes
+void oam_shadow_end(void);
+
+#endif // oamshadow.h
@@ -0,0 +1,141 @@
+
+; Escrita na OAM com controle de alterações (ver oamshadow.h).
+; O próprio buffer da OAM ($200) é a sombra: cada byte é comparado antes
+; de ser escrito, e só os bytes diferentes são gravados e contados.
+;
+; Ciclos com o rts e sem o jsr de quem chama, medidos no núcleo de CPU do
+; tools/nes_trace com o metasprite do dragão (4 sprites, slots 1-4):
+;   oam_shadow_begin  18
+;   oam_shadow_meta   419 sem mudança, 459 só com o Y mudando, 579 com os
+;                     16 bytes mudando
+;   oam_shadow_end    41 sem slots a esconder
+; Na neslib da ROM de bin/ o mesmo quadro custava 359 (oam_meta_spr, que
+; grava sem comparar) + 953 (oam_hide_rest, que reescreve os 59 slots livres
+; a cada quadro): 1312 ciclos contra 518 no quadro comum, em que só o Y muda.
+; Tudo fica no banco fixo (segmento CODE).
+
+	.export _oam_shadow_reset, _oam_shadow_begin
+	.export _oam_shadow_meta, _oam_shadow_end
+
+	.importzp sp, ptr1, tmp1, tmp2, tmp3
+	.import incsp2
+	.import _dbg
+
+OAM_BUF = $0200
+
+; Mesmos valores de oamshadow.h
+OAM_FIRST_FREE = 4
+OAM_HIDDEN_Y   = $F0
+
+; dbg.oam_bytes é o primeiro campo de DebugCounters (debug.h)
+DBG_OAM_BYTES = _dbg
+
+.segment "BSS"
+
+; Índices de byte na OAM; 0 quer dizer 256 (OAM cheia), já que um quadro
+; sempre começa em OAM_FIRST_FREE
+oam_shadow_id:		.res 1	; próximo byte livre neste quadro
+oam_shadow_last:	.res 1	; fim dos slots usados no quadro anterior
+oam_shadow_bytes:	.res 1	; bytes escritos neste quadro
+
+.segment "CODE"
+
+; void oam_shadow_reset(void)
+_oam_shadow_reset:
+	lda #OAM_FIRST_FREE
+	sta oam_shadow_last
+	rts
+
+; void oam_shadow_begin(void)
+_oam_shadow_begin:
+	lda #OAM_FIRST_FREE
+	sta oam_shadow_id
+	lda #0
+	sta oam_shadow_bytes
+	rts
+
+; void __fastcall__ oam_shadow_meta(byte x, byte y, const byte* data)
+; Entrada: A/X = data, (sp),0 = y, (sp),1 = x.
+_oam_shadow_meta:
+	sta ptr1		; 3
+	stx ptr1+1		; 3
+	ldy #0			; 2
+	lda (sp),y		; 5
+	sta tmp1		; 3   y
+	iny			; 2
+	lda (sp),y		; 5
+	sta tmp2		; 3   x
+	ldx oam_shadow_id	; 4
+	beq @done		; 2   OAM cheia
+	dey			; 2
+@sprite:
+	lda (ptr1),y		; 5   dx
+	cmp #128		; 2
+	beq @done		; 2
+	clc			; 2
+	adc tmp2		; 3
+	sta tmp3		; 3   x da tela, gravado por último
+	iny			; 2
+	lda (ptr1),y		; 5   dy
+	clc			; 2
+	adc tmp1		; 3
+	cmp OAM_BUF+0,x		; 4
+	beq :+			; 3
+	sta OAM_BUF+0,x		; 5 + 6 por byte escrito (com o beq e o inc)
+	inc oam_shadow_bytes	; 6
+:	iny			; 2
+	lda (ptr1),y		; 5   tile
+	cmp OAM_BUF+1,x		; 4
+	beq :+			; 3
+	sta OAM_BUF+1,x
+	inc oam_shadow_bytes
+:	iny			; 2
+	lda (ptr1),y		; 5   atributos
+	cmp OAM_BUF+2,x		; 4
+	beq :+			; 3
+	sta OAM_BUF+2,x
+	inc oam_shadow_bytes
+:	lda tmp3		; 3
+	cmp OAM_BUF+3,x		; 4
+	beq :+			; 3
+	sta OAM_BUF+3,x
+	inc oam_shadow_bytes
+:	iny			; 2
+	inx			; 2
+	inx			; 2
+	inx			; 2
+	inx			; 2
+	bne @sprite		; 3   0: passou do último slot
+@done:
+	stx oam_shadow_id	; 4
+	jmp incsp2		; 3   descarta x e y
+
+; void oam_shadow_end(void)
+; Esconde os slots de oam_shadow_id até oam_shadow_last (só os que estavam
+; visíveis no quadro anterior) e publica dbg.oam_bytes.
+_oam_shadow_end:
+	ldx oam_shadow_id
+	beq @publish		; OAM cheia: nada sobrou
+	lda oam_shadow_last
+	beq @hide		; o quadro anterior ia até o fim
+	cpx oam_shadow_last
+	bcs @publish		; este quadro usou pelo menos tantos slots
+@hide:
+	lda #OAM_HIDDEN_Y
+@slot:
+	cmp OAM_BUF,x
+	beq :+
+	sta OAM_BUF,x
+	inc oam_shadow_bytes
+:	inx
+	inx
+	inx
+	inx
+	cpx oam_shadow_last
+	bne @slot
+@publish:
+	lda oam_shadow_id
+	sta oam_shadow_last
+	lda oam_shadow_bytes
+	sta DBG_OAM_BYTES
+	rts
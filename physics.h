@@ -0,0 +1,106 @@
+
+#ifndef _PHYSICS_H
+#define _PHYSICS_H
+
+// Física e geometria do jogo, compartilhadas entre o jogo (cc65) e as
+// ferramentas do host (tools/). Só macros: nada aqui depende da neslib.
+// No host, as variáveis do dragão devem ter os mesmos tamanhos do cc65
+// (int de 16 bits, byte sem sinal).
+
+
+//--------------------------------------------------------//
+//                   SISTEMA DE SUBPIXEL                  //
+//--------------------------------------------------------//
+
+// Configuração de ponto fixo (subpixels) para movimento suave
+#define SUBPIXEL_SHIFT 4                        // 2^4 = 16 subpixels por pixel
+#define SUBPIXEL_UNIT (1 << SUBPIXEL_SHIFT)     // Representa 1 pixel em unidades de subpixel (16)
+
+
+//--------------------------------------------------------//
+//                   FÍSICA DO DRAGÃO                     //
+//--------------------------------------------------------//
+
+// Constantes de posição do dragão
+#define DRAGON_X_POS 50                 // Posição X fixa do dragão em pixels
+#define DRAGON_INIT_Y_POS 50            // Posição Y inicial do dragão em pixels
+#define DRAGON_SIZE 16                  // Metasprite de 16x16 pixels
+
+// Limites de movimento vertical do dragão na tela
+#define DRAGON_MIN_Y 28                 // Limite superior da tela para o jogador
+#define DRAGON_MAX_Y 194                // Limite inferior da tela para o jogador
+
+// Constantes da física do dragão
+#define GRAVITY 4                       // Força da gravidade aplicada ao dragão (em subpixels/quadro²)
+#define MAX_GRAVITY 80                  // Velocidade máxima de queda (em subpixels/quadro)
+#define JUMP_SPEED -64                  // Velocidade inicial do pulo (negativa para subir)
+
+// Um quadro da física do dragão (pulo e gravidade).
+// "d" é um struct com y_pos (byte), y_vel e y_pos_subpixel (int de 16 bits);
+// "jump" é verdadeiro no quadro em que o botão A foi apertado.
+#define DRAGON_PHYSICS_STEP(d, jump) {\
+    /* Inicia o pulo */\
+    if (jump) {\
+        (d).y_vel = JUMP_SPEED;\
+    }\
+    /* Aplica a gravidade, limitada à velocidade máxima de queda */\
+    (d).y_vel += GRAVITY;\
+    if ((d).y_vel > MAX_GRAVITY) {\
+        (d).y_vel = MAX_GRAVITY;\
+    }\
+    /* Atualiza a posição em subpixels e converte para pixels */\
+    (d).y_pos_subpixel += (d).y_vel;\
+    (d).y_pos = (d).y_pos_subpixel >> SUBPIXEL_SHIFT;\
+    /* Mantém o dragão entre o teto e o chão (e zera a velocidade) */\
+    if ((d).y_pos < DRAGON_MIN_Y) {\
+        (d).y_pos = DRAGON_MIN_Y;\
+        (d).y_pos_subpixel = (d).y_pos << SUBPIXEL_SHIFT;\
+        (d).y_vel = 0;\
+    }\
+    if ((d).y_pos > DRAGON_MAX_Y) {\
+        (d).y_pos = DRAGON_MAX_Y;\
+        (d).y_pos_subpixel = (d).y_pos << SUBPIXEL_SHIFT;\
+        (d).y_vel = 0;\
+    }\
+}
+
+
+//--------------------------------------------------------//
+//                  SCROLL E TORRES                       //
+//--------------------------------------------------------//
+
+#define SCROLL_SPEED 16         // Velocidade do scroll em subpixels por quadro
+
+// Parâmetros da torre
+#define TOWER_HEIGHT       22      // Altura total da torre (em tiles verticais)
+#define TOWER_COLUMNS      4       // Número de colunas por torre (L, M, M, R)
+#define TOWER_GAP_HEIGHT   6       // Tamanho vertical do gap em tiles
+#define SCORE_HEIGHT       4       // Linhas reservadas para a pontuação
+
+#define TOWER_WIDTH_PX (TOWER_COLUMNS << 3)
+
+// As torres ficam a cada 16 colunas (duas por nametable) e são desenhadas
+// na ordem 2, 3, 0, 1, 2... A k-ésima torre desenhada numa partida está em
+// TOWER_FIRST_X + k * TOWER_SPACING_PX, em pixels de scroll sem dar a volta.
+#define TOWER_SPACING_PX 128
+#define TOWER_FIRST_X    256
+
+// Caixa de colisão do dragão, menor que o metasprite
+#define DRAGON_HIT_INSET 2
+
+// Verdadeiro se uma torre na posição x da tela "tx" (pode ser negativa)
+// cobre horizontalmente a caixa de colisão do dragão
+#define TOWER_OVERLAPS_DRAGON(tx)\
+    ((tx) < DRAGON_X_POS + DRAGON_SIZE - DRAGON_HIT_INSET &&\
+     (tx) + TOWER_WIDTH_PX > DRAGON_X_POS + DRAGON_HIT_INSET)
+
+// Primeira linha (em pixels) do gap que começa no tile "gap"
+#define GAP_TOP_PX(gap) (((gap) + SCORE_HEIGHT) << 3)
+
+// Verdadeiro se a caixa de colisão do dragão em "y" cabe no gap.
+// Sprites aparecem uma linha abaixo do Y gravado na OAM, por isso o +1.
+#define DRAGON_IN_GAP(y, gap)\
+    ((y) + 1 + DRAGON_HIT_INSET >= GAP_TOP_PX(gap) &&\
+     (y) + 1 + DRAGON_SIZE - DRAGON_HIT_INSET <= GAP_TOP_PX(gap) + (TOWER_GAP_HEIGHT << 3))
+
+#endif // physics.h
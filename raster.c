@@ -0,0 +1,72 @@
+
+#include "neslib.h"
+#include "raster.h"
+
+// listas definidas em raster.s
+extern byte raster_back_count;
+extern byte raster_back_latch[RASTER_MAX_SPLITS];
+extern byte raster_back_ctrl[RASTER_MAX_SPLITS];
+extern byte raster_back_scroll[RASTER_MAX_SPLITS];
+extern byte raster_back_deadline;
+extern byte raster_ready;
+extern byte raster_split0_ctrl;
+extern byte raster_split0_scroll;
+word __fastcall__ raster_sprite0_poll(void);
+
+// scanline do último split acrescentado
+static byte raster_last_line;
+
+void raster_init(void) {
+  // lista vazia, só com o prazo
+  raster_begin();
+  raster_end();
+  nmi_set_callback(raster_irq_nmi);
+  asm("cli");
+}
+
+void raster_begin(void) {
+  // impede o NMI de adotar uma lista pela metade
+  raster_ready = 0;
+  raster_back_count = 0;
+  raster_last_line = 0;
+}
+
+bool raster_add(byte scanline, word scroll_x) {
+  byte i = raster_back_count;
+
+  if (i >= RASTER_MAX_SPLITS) return false;
+  if (scanline < RASTER_MIN_LINE || scanline > RASTER_MAX_LINE) return false;
+  if (i && scanline < raster_last_line + RASTER_MIN_GAP) return false;
+
+  // A IRQ do primeiro split é contada a partir do início do quadro;
+  // as seguintes, a partir do scanline da IRQ anterior.
+  // Com o latch N a IRQ acontece no fim do N-ésimo scanline contado,
+  // e os registradores escritos nela valem para o scanline seguinte.
+  if (i == 0) {
+    raster_back_latch[i] = scanline - 1;
+  } else {
+    raster_back_latch[i] = scanline - raster_last_line - 1;
+  }
+  raster_back_ctrl[i] = (get_ppu_ctrl_var() & 0xFC) | ((scroll_x >> 8) & 1);
+  raster_back_scroll[i] = scroll_x;
+  raster_last_line = scanline;
+  raster_back_count = i + 1;
+  return true;
+}
+
+void raster_end(void) {
+  // IRQ do prazo contada do último split (ou do início do quadro); sem
+  // espaço para ela, o prazo é o último split
+  if (raster_last_line + RASTER_MIN_GAP <= RASTER_DEADLINE_LINE) {
+    raster_back_deadline = RASTER_DEADLINE_LINE - raster_last_line - 1;
+  } else {
+    raster_back_deadline = 0;
+  }
+  raster_ready = 1;
+}
+
+word raster_wait_sprite0(word scroll_x) {
+  raster_split0_ctrl = (get_ppu_ctrl_var() & 0xFC) | ((scroll_x >> 8) & 1);
+  raster_split0_scroll = scroll_x;
+  return raster_sprite0_poll();
+}
@@ -0,0 +1,62 @@
+
+#ifndef _RASTER_H
+#define _RASTER_H
+
+#include "neslib.h"
+
+// Escalonador de splits de scroll no meio do quadro, usando a IRQ de
+// scanline do MMC3. Cada quadro o jogo monta uma lista de
+// (scanline, scroll_x); a lista vale a partir do próximo vblank.
+//
+// A IRQ do MMC3 conta bordas de A12, então o background deve usar a
+// pattern table 0 e os sprites a pattern table 1 (bank_bg(0), bank_spr(1)).
+
+#define RASTER_MAX_SPLITS 4     // splits por quadro
+#define RASTER_MIN_LINE   32    // primeiro scanline possível (depois do sprite zero)
+#define RASTER_MAX_LINE   238   // último scanline visível com margem
+#define RASTER_MIN_GAP    2     // distância mínima entre splits (latch >= 1)
+
+// Prazo do trabalho de fundo (idle.c): a IRQ é rearmada depois do último
+// split para esta linha e liga raster_late até o próximo NMI. Se o último
+// split vem depois do prazo, raster_late liga nele. Da linha 232 até o
+// vblank (linha 241) são ~1000 ciclos.
+#define RASTER_DEADLINE_LINE 232
+
+// Instala o callback de NMI/IRQ e libera as IRQs da CPU.
+void raster_init(void);
+
+// Começa uma nova lista de splits para o próximo quadro.
+void raster_begin(void);
+
+// Acrescenta um split; scanlines em ordem crescente.
+// Retorna false se o split foi descartado (fora da ordem, da tela ou da lista).
+bool raster_add(byte scanline, word scroll_x);
+
+// Publica a lista (e o prazo); o NMI a adota no próximo vblank.
+void raster_end(void);
+
+// Espera o sprite zero e aplica scroll_x abaixo dele, como split(scroll_x, 0)
+// da neslib, mas contando as voltas do laço de espera desde o fim do NMI.
+// O retorno vezes RASTER_POLL_CYCLES é a folga até a linha do sprite zero.
+// Um valor acima de RASTER_POLL_LATE indica que o NMI passou dessa linha
+// e a espera perdeu um quadro inteiro.
+#define RASTER_POLL_CYCLES 12
+#define RASTER_POLL_LATE   1000   // ~12000 ciclos; a folga normal fica abaixo de 420
+word raster_wait_sprite0(word scroll_x);
+
+// Callback de NMI/IRQ (raster.s). A com bit 7 ligado indica IRQ.
+void __fastcall__ raster_irq_nmi(void);
+
+// Se diferente de zero, cada split alterna a escala de cinza da PPU,
+// marcando na tela as linhas exatas em que os splits aconteceram.
+extern byte raster_debug;
+
+// Splits da lista anterior que não chegaram a executar antes do vblank
+// (lista sem tempo para terminar, ou IRQ atrasada demais).
+extern byte raster_missed;
+
+// Diferente de zero depois da IRQ do prazo (RASTER_DEADLINE_LINE) deste
+// quadro; o NMI desliga.
+extern byte raster_late;
+
+#endif // raster.h
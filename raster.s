@@ -0,0 +1,187 @@
+
+; Callback de NMI/IRQ do escalonador de splits (ver raster.h).
+; A neslib salva A/X/Y antes de chamar o callback e chama com A = $FF
+; quando a interrupção é uma IRQ.
+; Fica no banco fixo e não usa registradores de zero page do cc65,
+; para poder interromper o código C a qualquer momento.
+; No fim do NMI, depois do trabalho da PPU, roda o famitone_update
+; quando audio_schedule() (audio.c) o liberou para este quadro.
+; Depois do último split a IRQ é rearmada para RASTER_DEADLINE_LINE e
+; liga raster_late, o prazo do trabalho de fundo (idle.c).
+
+	.export _raster_irq_nmi, _raster_irq
+	.export _raster_back_count, _raster_back_latch
+	.export _raster_back_ctrl, _raster_back_scroll
+	.export _raster_ready, _raster_debug, _raster_missed
+	.export _raster_back_deadline, _raster_late
+	.export _raster_sprite0_poll
+	.export _raster_split0_ctrl, _raster_split0_scroll
+
+	.import _famitone_update
+	.import _audio_nmi_pending, _audio_nmi_done
+
+RASTER_MAX_SPLITS = 4
+
+PPU_CTRL  = $2000
+PPU_MASK  = $2001
+PPU_STATUS = $2002
+PPU_SCROLL = $2005
+
+MMC3_IRQ_LATCH   = $C000
+MMC3_IRQ_RELOAD  = $C001
+MMC3_IRQ_DISABLE = $E000
+MMC3_IRQ_ENABLE  = $E001
+
+DEBUG_MASK = $1E		; BG + sprites + colunas da esquerda
+
+.segment "BSS"
+
+; lista montada pelo jogo durante o quadro (raster.c)
+_raster_back_count:	.res 1
+_raster_back_latch:	.res RASTER_MAX_SPLITS
+_raster_back_ctrl:	.res RASTER_MAX_SPLITS
+_raster_back_scroll:	.res RASTER_MAX_SPLITS
+_raster_back_deadline:	.res 1	; latch do prazo depois do último split (0 = no split)
+_raster_ready:		.res 1
+
+; lista em execução neste quadro
+front_count:	.res 1
+front_latch:	.res RASTER_MAX_SPLITS
+front_ctrl:	.res RASTER_MAX_SPLITS
+front_scroll:	.res RASTER_MAX_SPLITS
+front_next:	.res 1		; próximo split a executar
+front_deadline:	.res 1
+
+_raster_debug:	.res 1
+_raster_missed:	.res 1
+_raster_late:	.res 1		; o prazo deste quadro já passou
+
+; scroll abaixo do sprite zero (raster_wait_sprite0)
+_raster_split0_ctrl:	.res 1
+_raster_split0_scroll:	.res 1
+
+.segment "CODE"
+
+_raster_irq_nmi:
+	cmp #$80
+	bcs _raster_irq
+
+; NMI: conta os splits que não executaram e adota a nova lista
+nmi:
+	lda front_count
+	sec
+	sbc front_next
+	sta _raster_missed
+	lda _raster_ready
+	beq @keep
+	lda _raster_back_deadline
+	sta front_deadline
+	ldx _raster_back_count
+	stx front_count
+	beq @copied
+@copy:
+	dex
+	lda _raster_back_latch,x
+	sta front_latch,x
+	lda _raster_back_ctrl,x
+	sta front_ctrl,x
+	lda _raster_back_scroll,x
+	sta front_scroll,x
+	txa
+	bne @copy
+@copied:
+	lda #0
+	sta _raster_ready
+@keep:
+	lda #0
+	sta front_next
+	sta _raster_late
+	sta MMC3_IRQ_DISABLE	; desliga e reconhece IRQ pendente
+	lda front_latch		; primeiro split
+	ldx front_count
+	bne :+
+	lda front_deadline	; sem splits: só o prazo, contado do início
+:	sta MMC3_IRQ_LATCH
+	sta MMC3_IRQ_RELOAD
+	sta MMC3_IRQ_ENABLE
+	lda _audio_nmi_pending
+	beq @noaudio
+	lda #0
+	sta _audio_nmi_pending
+	lda #1
+	sta _audio_nmi_done
+	jmp _famitone_update
+@noaudio:
+	rts
+
+; IRQ: aplica o split atual e arma o próximo (ou o prazo). Exportado só
+; para o tools/wcet.txt anotar a raiz da IRQ pelo nome.
+_raster_irq:
+	sta MMC3_IRQ_DISABLE	; reconhece a IRQ
+	ldx front_next
+	cpx front_count
+	bcs @late		; depois do último split: é a IRQ do prazo
+	lda front_ctrl,x
+	ldy front_scroll,x
+	sta PPU_CTRL
+	sty PPU_SCROLL
+	lda #0
+	sta PPU_SCROLL
+	lda _raster_debug
+	beq @nodebug
+	txa
+	and #1
+	eor #1			; splits pares em cinza, ímpares coloridos
+	ora #DEBUG_MASK
+	sta PPU_MASK
+@nodebug:
+	inx
+	stx front_next
+	cpx front_count
+	bcs @deadline
+	lda front_latch,x
+@arm:
+	sta MMC3_IRQ_LATCH
+	sta MMC3_IRQ_RELOAD
+	sta MMC3_IRQ_ENABLE
+	rts
+@deadline:
+	lda front_deadline	; 0: o último split já passou do prazo
+	bne @arm
+@late:
+	lda #1
+	sta _raster_late
+	rts
+
+; Espera o sprite zero, contando as voltas desde o fim do NMI, e aplica o
+; scroll de raster_split0_ctrl/scroll. Cada volta leva 12 ciclos
+; (RASTER_POLL_CYCLES); o total volta em A/X.
+; Primeiro espera o fim do vblank (a marca do quadro anterior se apaga),
+; depois a colisão do sprite zero neste quadro.
+_raster_sprite0_poll:
+	ldx #0
+	ldy #0
+@wait_clear:
+	inx			; 2
+	bne :+			; 3 (2 + 2 do iny a cada 256 voltas)
+	iny
+:	bit PPU_STATUS		; 4
+	bvs @wait_clear		; 3
+@wait_hit:
+	inx
+	bne :+
+	iny
+:	bit PPU_STATUS
+	bvc @wait_hit
+	lda _raster_split0_ctrl
+	sta PPU_CTRL
+	lda _raster_split0_scroll
+	sta PPU_SCROLL
+	lda #0
+	sta PPU_SCROLL
+	txa
+	pha
+	tya
+	tax
+	pla
+	rts
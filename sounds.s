@@ -0,0 +1,66 @@
+
+; Dados de áudio da FamiTone2 (ver audio.c).
+;
+; dragon_music: cabeçalho de música sem nenhuma música. A FamiTone só lê
+; daqui as listas de instrumentos e samples em famitone_init; para ter
+; música, exportar do FamiTracker com o text2data e trocar este bloco.
+;
+; dragon_sounds: efeitos no formato do nsf2data, escritos à mão.
+; Cada efeito é uma sequência de bytes:
+;   $80+n, valor  escreve "valor" no registrador n do buffer do efeito
+;                 (0-2 pulso 1: $4000 $4002 $4003, 3-5 pulso 2: $4004 $4006 $4007,
+;                  6-8 triângulo: $4008 $400A $400B, 9-10 ruído: $400C $400E)
+;   $01-$7F       mantém os registradores por esse número de quadros
+;   $00           fim do efeito
+; A ordem da lista segue SFX_JUMP, SFX_SCORE e SFX_CRASH em audio.h.
+; Fica no banco fixo, pois é lida pelo NMI.
+
+	.export _dragon_music, _dragon_sounds
+
+.segment "RODATA"
+
+_dragon_music:
+	.byte 0			; nenhuma música
+	.word music_instruments
+	.word music_samples-3
+music_instruments:
+music_samples:
+
+_dragon_sounds:
+	.word sfx_list		; NTSC
+	.word sfx_list		; PAL (mesmos dados)
+sfx_list:
+	.word sfx_jump
+	.word sfx_score
+	.word sfx_crash
+
+; Pulo: pulso 1 subindo de tom, 8 quadros
+sfx_jump:
+	.byte $80,$BF,$81,$50,$82,$01,$01
+	.byte $80,$BE,$81,$20,$01
+	.byte $80,$BD,$81,$00,$01
+	.byte $80,$BC,$81,$E0,$82,$00,$01
+	.byte $80,$BA,$81,$C8,$01
+	.byte $80,$B8,$81,$B4,$01
+	.byte $80,$B5,$81,$A0,$01
+	.byte $80,$B2,$81,$90,$01
+	.byte $80,$30,$00
+
+; Ponto: duas notas no pulso 2, 12 quadros
+sfx_score:
+	.byte $83,$7F,$84,$A9,$85,$00,$05
+	.byte $83,$7C,$84,$71,$04
+	.byte $83,$76,$02
+	.byte $83,$72,$01
+	.byte $83,$30,$00
+
+; Batida: ruído descendo e uma nota grave no pulso 1, 30 quadros
+sfx_crash:
+	.byte $80,$3F,$81,$F0,$82,$03,$89,$3F,$8A,$04,$02
+	.byte $80,$3D,$81,$80,$82,$04,$89,$3E,$8A,$06,$03
+	.byte $80,$3A,$89,$3C,$8A,$08,$04
+	.byte $80,$36,$89,$3A,$8A,$0A,$05
+	.byte $80,$33,$89,$37,$8A,$0C,$06
+	.byte $80,$30,$89,$34,$8A,$0E,$06
+	.byte $89,$32,$03
+	.byte $89,$30,$00
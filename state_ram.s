@@ -0,0 +1,17 @@
+; Variáveis do jogo em zero page.
+; ZEROPAGE é permanente; ZP_TITLE, ZP_PLAY e ZP_OVER são overlays que
+; ocupam os mesmos endereços (ver dragons_leap.cfg) e só valem enquanto
+; o estado correspondente está ativo.
+; Do lado do C, cada símbolo é declarado com extern + #pragma zpsym.
+
+	.exportzp _scroll_x, _scroll_x_subpixel
+	.exportzp _dragon
+
+.segment "ZEROPAGE"
+
+_scroll_x_subpixel:	.res 2	; int
+_scroll_x:		.res 2	; word
+
+.segment "ZP_PLAY": zeropage
+
+_dragon:		.res 6	; Dragon (DRAGON_ZP_SIZE)
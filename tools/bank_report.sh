@@ -0,0 +1,81 @@
+#!/bin/sh
+#
+# Relatório de ocupação por banco/área de memória, incluindo a zero page
+# e a RAM de cada estado do jogo (overlays ZPOVL_* e RAMOVL_*).
+#
+# Uso: tools/bank_report.sh dragons_leap.cfg dragons_leap.map
+#
+# Lê a seção MEMORY e SEGMENTS do .cfg (qual segmento carrega/roda em qual
+# área) e soma os tamanhos da "Segment list" do mapfile gerado pelo ld65
+# (opção -m). Segmentos com "run =" contam na área de execução também.
+
+if [ $# -ne 2 ]; then
+    echo "uso: $0 <arquivo.cfg> <arquivo.map>" >&2
+    exit 2
+fi
+
+awk '
+function hex(s,   i, c, v) {
+    v = 0
+    s = tolower(s)
+    sub(/^\$/, "", s)
+    for (i = 1; i <= length(s); i++) {
+        c = index("0123456789abcdef", substr(s, i, 1))
+        if (c == 0) break
+        v = v * 16 + c - 1
+    }
+    return v
+}
+function field(line, key,   re, m) {
+    re = key "[ \t]*=[ \t]*[^,;]+"
+    if (match(line, re)) {
+        m = substr(line, RSTART, RLENGTH)
+        sub(/^[^=]*=[ \t]*/, "", m)
+        gsub(/[ \t]/, "", m)
+        return m
+    }
+    return ""
+}
+# 1o arquivo: .cfg
+FNR == NR {
+    sub(/#.*/, "")
+    if ($0 ~ /^[ \t]*MEMORY/)   { sect = "mem"; next }
+    if ($0 ~ /^[ \t]*SEGMENTS/) { sect = "seg"; next }
+    if ($0 ~ /^[ \t]*}/)        { sect = ""; next }
+    if ($0 !~ /:/) next
+    name = $0; sub(/:.*/, "", name); gsub(/[ \t]/, "", name)
+    if (sect == "mem") {
+        if (field($0, "file") == "")
+            ram[name] = 1
+        size[name] = hex(field($0, "size"))
+        order[++n] = name
+    } else if (sect == "seg") {
+        load[name] = field($0, "load")
+        run[name] = field($0, "run")
+    }
+    next
+}
+# 2o arquivo: mapfile
+/^Segment list:/ { inseg = 1; next }
+inseg && /^[A-Za-z_]/ && NF == 5 && $1 != "Name" {
+    s = hex($4)
+    if ($1 in load) {
+        used[load[$1]] += s
+        if (run[$1] != "") used[run[$1]] += s
+    }
+    next
+}
+inseg && /^$/ && seen { inseg = 0 }
+inseg { seen = 1 }
+END {
+    printf "%-10s %8s %8s %6s\n", "area", "usado", "total", "uso"
+    for (i = 1; i <= n; i++) {
+        a = order[i]
+        if (size[a] == 0) continue
+        printf "%-10s %8d %8d %5d%%%s\n", a, used[a], size[a], \
+            int(used[a] * 100 / size[a]), (a in ram) ? "  (RAM)" : ""
+        if (used[a] > size[a]) over = 1
+    }
+    exit over
+}
+' "$1" "$2"
@@ -0,0 +1,350 @@
+//--------------------------------------------------------//
+//        Dragon's Leap - fuzzing da lógica do jogo       //
+//--------------------------------------------------------//
+//
+// Ferramenta do host (não roda no NES). Compila a lógica de dragons_leap.c
+// (scroll, linha do tempo, torres, física, pontuação, fim de jogo) e o
+// escritor do buffer da VRAM (vrambuf.c, chrstream.c) para o host, com as
+// versões em C das rotinas de hotpath.s e as invariantes (CHECK_INVARIANTS)
+// ligadas. O hardware fica atrás de um shim: neslib, mapper, raster, áudio
+// e OAM viram funções vazias, o buffer da VRAM é um array e a porta de
+// teste das invariantes vira um abort().
+//
+// Cada entrada do fuzzer é uma partida de FUZZ_FRAMES quadros:
+//   bytes 0-1  level_start_seed (little endian): semente da primeira fase
+//   byte 2     scroll_speed durante o jogo: 1 + b % FUZZ_MAX_SPEED
+//   byte 3     bits 0-2: passos das tarefas de fundo por quadro, para a
+//              lógica usar tanto os gaps sorteados à frente quanto os da hora;
+//              bit 3: piloto (FUZZ_PILOT), que aperta A para manter o dragão
+//              no próximo gap, e assim a partida passa das primeiras torres
+//   bytes 4-   botões do controle, um byte por quadro, repetidos em ciclo
+// A partida começa pelo mesmo caminho de main() (tela de título), e entre
+// entradas só é refeito o que main() faz antes do laço: nada é alocado nem
+// liberado, e o resto do estado vem da entrada de cada estado do jogo,
+// como no NES.
+//
+// Além das invariantes de dragons_leap.c (endereços do buffer da VRAM,
+// VRAMBUF_FRAME_MAX, uma vez cada torre por volta do scroll, dragão e
+// scroll dentro da faixa), falham aqui um vrambuf_put() que encheria o
+// buffer (o vrambuf_flush() no meio do quadro) e um int que não caberia
+// nos 16 bits do cc65 (no host o int tem 32).
+//
+// Compilar com o libFuzzer:
+//   clang -g -O1 -fsanitize=fuzzer,address,undefined -DFUZZ_LIBFUZZER
+//         -Itools/host -o tools/fuzz_logic tools/fuzz_logic.c
+//   tools/fuzz_logic [opções do libFuzzer] [corpus]
+// Sem o libFuzzer (entradas sorteadas, ou os arquivos dados, como os
+// crash-* do libFuzzer):
+//   cc -O2 -Itools/host -o tools/fuzz_logic tools/fuzz_logic.c
+//   tools/fuzz_logic [-n entradas] [-s semente] [arquivo...]
+//
+// Falha com abort() (código 134 sem o libFuzzer) na primeira violação.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define FUZZ_FRAMES     4096
+#define FUZZ_MAX_SPEED  64          // subpixels por quadro: 4 pixels
+#define FUZZ_HEADER     4
+#define FUZZ_IDLE_MASK  0x07
+#define FUZZ_PILOT      0x08
+#define DEFAULT_INPUTS  1000
+#define MAX_INPUT       4096
+
+
+//--------------------------------------------------------//
+//                  LÓGICA DO JOGO                        //
+//--------------------------------------------------------//
+
+// Antes dos fontes do jogo: o que o cc65 e o hardware definiriam
+#define __fastcall__
+#define HOTPATH_ASM      0
+#define CHECK_INVARIANTS 1
+
+static unsigned char fuzz_updbuf[256];   // a página $100 do NES
+#define updbuf fuzz_updbuf
+
+static void fuzz_test_port(unsigned char v);
+#define test_port(v) fuzz_test_port(v)
+
+#define main dragons_leap_main
+
+#undef NULL     // neslib.h define o seu
+
+// #pragma do cc65, tiles 0x1NN (tabela 1) em bytes e char sem sinal
+#pragma GCC diagnostic ignored "-Wunknown-pragmas"
+#pragma GCC diagnostic ignored "-Woverflow"
+#pragma GCC diagnostic ignored "-Wpointer-sign"
+
+#include "../vrambuf.c"
+#include "../chrstream.c"
+// bcd.c define bcd_add() com word, o bcd.h com unsigned int: no cc65 são o
+// mesmo tipo, no host não
+#define bcd_add bcd_add_word
+#include "../bcd.c"
+#undef bcd_add
+#include "../debug.c"
+#include "../idle.c"
+#include "../dragons_leap.c"
+
+#undef main
+
+unsigned int bcd_add(unsigned int a, unsigned int b) {
+    return bcd_add_word(a, b);
+}
+
+
+//--------------------------------------------------------//
+//                       SHIM                             //
+//--------------------------------------------------------//
+
+static uint8_t fuzz_pad, fuzz_pad_last;
+static uint8_t fuzz_clock, fuzz_idle_left;
+static unsigned fuzz_frame;
+static const char* fuzz_origin = "";
+
+// Mostra a falha e os registros do buffer da VRAM deste quadro
+static void fuzz_fail(const char* what) {
+    int i = 0;
+
+    fprintf(stderr, "fuzz_logic: %s no quadro %u%s (estado %d, scroll_x %u, updptr %d)\n",
+            what, fuzz_frame, fuzz_origin, game_state, scroll_x, updptr);
+    while (i + 3 <= updptr) {
+        fprintf(stderr, "  %3d: $%04X%s %d bytes\n", i,
+                ((updbuf[i] << 8) | updbuf[i + 1]) & 0x3FFF,
+                (updbuf[i] & NT_UPD_VERT) ? " vertical" : "", updbuf[i + 2]);
+        i += 3 + updbuf[i + 2];
+    }
+    abort();
+}
+
+// check_fail() de dragons_leap.c: TEST_FAIL + TEST_INVARIANT + CHECK_*
+static void fuzz_test_port(unsigned char v) {
+    static const char* names[] = {
+        "CHECK_VRAM_ADDR", "CHECK_VRAM_SIZE", "CHECK_TOWER_CYCLE", "CHECK_DRAGON_Y", "CHECK_SCROLL"
+    };
+    unsigned id = (unsigned)(v - TEST_FAIL - TEST_INVARIANT);
+
+    if (v & TEST_FAIL) {
+        fuzz_fail(id < sizeof(names) / sizeof(names[0]) ? names[id] : "invariante");
+    }
+}
+
+// state_ram.s
+Dragon dragon;
+int scroll_x_subpixel;
+word scroll_x;
+
+// neslib: só o que a lógica usa. O pad_trigger() é o da neslib: os botões
+// apertados desde a leitura anterior.
+unsigned char pad_trigger(unsigned char pad) {
+    uint8_t t = fuzz_pad & ~fuzz_pad_last;
+    (void)pad;
+    fuzz_pad_last = fuzz_pad;
+    return t;
+}
+
+// idle_run() para quando o nesclock() muda: depois de fuzz_idle_left
+// leituras, o "NMI" chega
+unsigned char nesclock(void) {
+    if (fuzz_idle_left) {
+        --fuzz_idle_left;
+        return fuzz_clock;
+    }
+    return (uint8_t)(fuzz_clock + 1);
+}
+
+// vrambuf_flush(): o buffer encheu no meio do quadro
+void ppu_wait_frame(void) {
+    fuzz_fail("vrambuf_put() passou de VBUFSIZE");
+}
+
+void ppu_wait_nmi(void) {}
+void ppu_on_all(void) {}
+void vram_adr(unsigned int adr) { (void)adr; }
+void vram_write(const unsigned char* src, unsigned int size) { (void)src; (void)size; }
+void set_vram_update(unsigned char* buf) { (void)buf; }
+void pal_all(const char* data) { (void)data; }
+void bank_bg(unsigned char n) { (void)n; }
+void bank_spr(unsigned char n) { (void)n; }
+void oam_clear(void) {}
+unsigned char oam_spr(unsigned char x, unsigned char y, unsigned char chrnum,
+                      unsigned char attr, unsigned char sprid) {
+    (void)x; (void)y; (void)chrnum; (void)attr;
+    return sprid + 4;
+}
+
+// mmc3.s, chr_generic.s
+byte mmc3_prg_bank;
+const byte tileset_chr[1];
+void mmc3_init(void) {}
+void mmc3_set_prg_8000(byte bank) { mmc3_prg_bank = bank; }
+
+// raster.c, raster.s
+byte raster_debug, raster_missed, raster_late;
+void raster_init(void) {}
+void raster_begin(void) {}
+bool raster_add(byte scanline, word x) { (void)scanline; (void)x; return true; }
+void raster_end(void) {}
+word raster_wait_sprite0(word x) { (void)x; return 0; }
+
+// audio.c
+void audio_init(void) {}
+void audio_sfx(byte sfx) { (void)sfx; }
+void audio_schedule(void) {}
+void audio_update_deferred(void) {}
+
+// oamshadow.s
+void oam_shadow_reset(void) {}
+void oam_shadow_begin(void) {}
+void oam_shadow_meta(byte x, byte y, const byte* data) { (void)x; (void)y; (void)data; }
+void oam_shadow_end(void) {}
+
+
+//--------------------------------------------------------//
+//                      PARTIDA                           //
+//--------------------------------------------------------//
+
+// Os ints do jogo têm 16 bits no cc65
+static void check_int16(void) {
+    if (dragon.y_vel != (int16_t)dragon.y_vel
+        || dragon.y_pos_subpixel != (int16_t)dragon.y_pos_subpixel
+        || scroll_x_subpixel != (int16_t)scroll_x_subpixel) {
+        fuzz_fail("int fora de 16 bits");
+    }
+}
+
+// Piloto: A quando, sem pular, a caixa de colisão do dragão passaria do
+// fundo do gap da próxima torre (a primeira que ainda não passou dele) no
+// quadro seguinte. O jogo só vê o A apertado agora, então depois de um
+// pulo o piloto solta o botão.
+static uint8_t pilot_pad(void) {
+    Dragon next = dragon;
+    uint8_t i, gap = TOWER_GAP_START;
+    int x, best = 0x7FFF;
+
+    for (i = 0; i < NUM_TOWERS; i++) {
+        x = tower_screen_x(i);
+        if (towers[i].visible && x + TOWER_WIDTH_PX > DRAGON_X_POS && x < best) {
+            best = x;
+            gap = towers[i].gap_start;
+        }
+    }
+    if (fuzz_pad_last & PAD_A) {
+        return 0;
+    }
+    DRAGON_PHYSICS_STEP(next, 0);
+    return next.y_pos + 1 + DRAGON_SIZE - DRAGON_HIT_INSET > GAP_TOP_PX(gap) + (TOWER_GAP_HEIGHT << 3)
+           ? PAD_A : 0;
+}
+
+static void fuzz_run(const uint8_t* data, size_t size) {
+    uint8_t header[FUZZ_HEADER] = { 0 };
+    const uint8_t* pads = data + FUZZ_HEADER;
+    size_t npads = size > FUZZ_HEADER ? size - FUZZ_HEADER : 0;
+    uint8_t speed, idle_steps, pilot, state;
+
+    memcpy(header, data, size < FUZZ_HEADER ? size : FUZZ_HEADER);
+    speed = 1 + header[2] % FUZZ_MAX_SPEED;
+    idle_steps = header[3] & FUZZ_IDLE_MASK;
+    pilot = header[3] & FUZZ_PILOT;
+
+    // O que main() faz antes do laço, sem o hardware
+    fuzz_pad = fuzz_pad_last = 0;
+    initialize_dragon_tiles();
+    vrambuf_clear();
+    initialize_scroll();
+    set_game_state(STATE_TITLE);
+    level_start_seed = header[0] | (header[1] << 8);
+
+    for (fuzz_frame = 0; fuzz_frame < FUZZ_FRAMES; fuzz_frame++) {
+        fuzz_pad = npads ? pads[fuzz_frame % npads] : 0;
+        if (pilot && game_state == STATE_PLAY) {
+            fuzz_pad = (fuzz_pad & ~PAD_A) | pilot_pad();
+        }
+        fuzz_idle_left = idle_steps + 1;        // + a leitura do idle_begin()
+        fuzz_clock++;
+
+        idle_begin();
+        vrambuf_clear();
+        state = game_state;
+        update_frame();
+        if (game_state == STATE_PLAY && state != STATE_PLAY) {
+            scroll_speed = speed;
+        }
+        check_int16();
+        idle_run(idle_tasks, IDLE_TASKS);
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    fuzz_run(data, size);
+    return 0;
+}
+
+
+#ifndef FUZZ_LIBFUZZER
+
+static void usage(const char* prog) {
+    fprintf(stderr, "uso: %s [-n entradas] [-s semente] [arquivo...]\n", prog);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    static uint8_t input[MAX_INPUT];
+    static char origin[64];
+    unsigned long inputs = DEFAULT_INPUTS, n;
+    uint32_t seed = 1, r;
+    size_t size, j;
+    int i, files = 0;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            inputs = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            seed = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+        } else {
+            FILE* f = fopen(argv[i], "rb");
+            if (!f) {
+                perror(argv[i]);
+                return 2;
+            }
+            size = fread(input, 1, sizeof(input), f);
+            fclose(f);
+            snprintf(origin, sizeof(origin), " de %s", argv[i]);
+            fuzz_origin = origin;
+            fuzz_run(input, size);
+            files++;
+        }
+    }
+    if (files) {
+        printf("%d arquivos, %u quadros cada, sem falhas\n", files, FUZZ_FRAMES);
+        return 0;
+    }
+
+    // Entradas sorteadas (xorshift32): a mesma semente repete as entradas
+    r = seed ? seed : 1;
+    for (n = 0; n < inputs; n++) {
+        r ^= r << 13;
+        r ^= r >> 17;
+        r ^= r << 5;
+        size = FUZZ_HEADER + r % 512;
+        for (j = 0; j < size; j++) {
+            r ^= r << 13;
+            r ^= r >> 17;
+            r ^= r << 5;
+            input[j] = (uint8_t)r;
+        }
+        snprintf(origin, sizeof(origin), " (entrada %lu da semente %u)", n, (unsigned)seed);
+        fuzz_origin = origin;
+        fuzz_run(input, size);
+    }
+    printf("%lu entradas sorteadas, %u quadros cada, sem falhas\n", inputs, FUZZ_FRAMES);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,8 @@
+
+#ifndef _HOST_NES_H
+#define _HOST_NES_H
+
+// Substituto do <nes.h> do cc65 para o build do host (tools/fuzz_logic.c).
+// A lógica do jogo não usa os registradores da PPU/APU por este header.
+
+#endif // nes.h
@@ -0,0 +1,14 @@
+
+#ifndef _HOST_PEEKPOKE_H
+#define _HOST_PEEKPOKE_H
+
+// Substituto do <peekpoke.h> do cc65 para o build do host
+// (tools/fuzz_logic.c): no host não há registradores do mapper, e as
+// escritas em endereços fixos são descartadas.
+
+#define POKE(addr,val)  ((void)(addr), (void)(val))
+#define POKEW(addr,val) ((void)(addr), (void)(val))
+#define PEEK(addr)      ((void)(addr), 0)
+#define PEEKW(addr)     ((void)(addr), 0)
+
+#endif // peekpoke.h
@@ -0,0 +1,328 @@
+
+#ifndef _M6502_H
+#define _M6502_H
+
+// Tabela de opcodes oficiais do 6502 (2A03), para as ferramentas do host
+// que executam ou analisam a ROM (tools/nes_trace.c, tools/wcet.c).
+// Ciclos são os do caso base; "page" indica +1 ciclo quando o endereço
+// indexado cruza uma página (só leituras). Desvios tomados custam +1,
+// e +1 de novo se o destino está em outra página.
+
+#include <stdint.h>
+
+enum {
+    AM_IMP, AM_ACC, AM_IMM, AM_ZP, AM_ZPX, AM_ZPY, AM_ABS,
+    AM_ABX, AM_ABY, AM_IND, AM_IZX, AM_IZY, AM_REL
+};
+
+// Bytes de cada instrução por modo de endereçamento
+static const uint8_t m6502_mode_bytes[] = {
+    1, 1, 2, 2, 2, 2, 3,
+    3, 3, 3, 2, 2, 2
+};
+
+typedef struct {
+    uint8_t op;         // M_*
+    uint8_t mode;       // AM_*
+    uint8_t cycles;
+    uint8_t page;
+} M6502Op;
+
+enum {
+    M_ADC, M_AND, M_ASL, M_BCC, M_BCS, M_BEQ, M_BIT, M_BMI,
+    M_BNE, M_BPL, M_BRK, M_BVC, M_BVS, M_CLC, M_CLD, M_CLI,
+    M_CLV, M_CMP, M_CPX, M_CPY, M_DEC, M_DEX, M_DEY, M_EOR,
+    M_INC, M_INX, M_INY, M_JMP, M_JSR, M_LDA, M_LDX, M_LDY,
+    M_LSR, M_NOP, M_ORA, M_PHA, M_PHP, M_PLA, M_PLP, M_ROL,
+    M_ROR, M_RTI, M_RTS, M_SBC, M_SEC, M_SED, M_SEI, M_STA,
+    M_STX, M_STY, M_TAX, M_TAY, M_TSX, M_TXA, M_TXS, M_TYA,
+    M_ILLEGAL
+};
+
+static const char* const m6502_names[] = {
+    "ADC", "AND", "ASL", "BCC", "BCS", "BEQ", "BIT", "BMI",
+    "BNE", "BPL", "BRK", "BVC", "BVS", "CLC", "CLD", "CLI",
+    "CLV", "CMP", "CPX", "CPY", "DEC", "DEX", "DEY", "EOR",
+    "INC", "INX", "INY", "JMP", "JSR", "LDA", "LDX", "LDY",
+    "LSR", "NOP", "ORA", "PHA", "PHP", "PLA", "PLP", "ROL",
+    "ROR", "RTI", "RTS", "SBC", "SEC", "SED", "SEI", "STA",
+    "STX", "STY", "TAX", "TAY", "TSX", "TXA", "TXS", "TYA",
+    "???"
+};
+
+static const M6502Op m6502_ops[256] = {
+    /* $00 */
+    { M_BRK, AM_IMP, 7, 0 },
+    { M_ORA, AM_IZX, 6, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ORA, AM_ZP, 3, 0 },
+    { M_ASL, AM_ZP, 5, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_PHP, AM_IMP, 3, 0 },
+    { M_ORA, AM_IMM, 2, 0 },
+    { M_ASL, AM_ACC, 2, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ORA, AM_ABS, 4, 0 },
+    { M_ASL, AM_ABS, 6, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    /* $10 */
+    { M_BPL, AM_REL, 2, 0 },
+    { M_ORA, AM_IZY, 5, 1 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ORA, AM_ZPX, 4, 0 },
+    { M_ASL, AM_ZPX, 6, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_CLC, AM_IMP, 2, 0 },
+    { M_ORA, AM_ABY, 4, 1 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ORA, AM_ABX, 4, 1 },
+    { M_ASL, AM_ABX, 7, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    /* $20 */
+    { M_JSR, AM_ABS, 6, 0 },
+    { M_AND, AM_IZX, 6, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_BIT, AM_ZP, 3, 0 },
+    { M_AND, AM_ZP, 3, 0 },
+    { M_ROL, AM_ZP, 5, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_PLP, AM_IMP, 4, 0 },
+    { M_AND, AM_IMM, 2, 0 },
+    { M_ROL, AM_ACC, 2, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_BIT, AM_ABS, 4, 0 },
+    { M_AND, AM_ABS, 4, 0 },
+    { M_ROL, AM_ABS, 6, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    /* $30 */
+    { M_BMI, AM_REL, 2, 0 },
+    { M_AND, AM_IZY, 5, 1 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_AND, AM_ZPX, 4, 0 },
+    { M_ROL, AM_ZPX, 6, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_SEC, AM_IMP, 2, 0 },
+    { M_AND, AM_ABY, 4, 1 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_AND, AM_ABX, 4, 1 },
+    { M_ROL, AM_ABX, 7, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    /* $40 */
+    { M_RTI, AM_IMP, 6, 0 },
+    { M_EOR, AM_IZX, 6, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_EOR, AM_ZP, 3, 0 },
+    { M_LSR, AM_ZP, 5, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_PHA, AM_IMP, 3, 0 },
+    { M_EOR, AM_IMM, 2, 0 },
+    { M_LSR, AM_ACC, 2, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_JMP, AM_ABS, 3, 0 },
+    { M_EOR, AM_ABS, 4, 0 },
+    { M_LSR, AM_ABS, 6, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    /* $50 */
+    { M_BVC, AM_REL, 2, 0 },
+    { M_EOR, AM_IZY, 5, 1 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_EOR, AM_ZPX, 4, 0 },
+    { M_LSR, AM_ZPX, 6, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_CLI, AM_IMP, 2, 0 },
+    { M_EOR, AM_ABY, 4, 1 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_EOR, AM_ABX, 4, 1 },
+    { M_LSR, AM_ABX, 7, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    /* $60 */
+    { M_RTS, AM_IMP, 6, 0 },
+    { M_ADC, AM_IZX, 6, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ADC, AM_ZP, 3, 0 },
+    { M_ROR, AM_ZP, 5, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_PLA, AM_IMP, 4, 0 },
+    { M_ADC, AM_IMM, 2, 0 },
+    { M_ROR, AM_ACC, 2, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_JMP, AM_IND, 5, 0 },
+    { M_ADC, AM_ABS, 4, 0 },
+    { M_ROR, AM_ABS, 6, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    /* $70 */
+    { M_BVS, AM_REL, 2, 0 },
+    { M_ADC, AM_IZY, 5, 1 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ADC, AM_ZPX, 4, 0 },
+    { M_ROR, AM_ZPX, 6, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_SEI, AM_IMP, 2, 0 },
+    { M_ADC, AM_ABY, 4, 1 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ADC, AM_ABX, 4, 1 },
+    { M_ROR, AM_ABX, 7, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    /* $80 */
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_STA, AM_IZX, 6, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_STY, AM_ZP, 3, 0 },
+    { M_STA, AM_ZP, 3, 0 },
+    { M_STX, AM_ZP, 3, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_DEY, AM_IMP, 2, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_TXA, AM_IMP, 2, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_STY, AM_ABS, 4, 0 },
+    { M_STA, AM_ABS, 4, 0 },
+    { M_STX, AM_ABS, 4, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    /* $90 */
+    { M_BCC, AM_REL, 2, 0 },
+    { M_STA, AM_IZY, 6, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_STY, AM_ZPX, 4, 0 },
+    { M_STA, AM_ZPX, 4, 0 },
+    { M_STX, AM_ZPY, 4, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_TYA, AM_IMP, 2, 0 },
+    { M_STA, AM_ABY, 5, 0 },
+    { M_TXS, AM_IMP, 2, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_STA, AM_ABX, 5, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    /* $A0 */
+    { M_LDY, AM_IMM, 2, 0 },
+    { M_LDA, AM_IZX, 6, 0 },
+    { M_LDX, AM_IMM, 2, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_LDY, AM_ZP, 3, 0 },
+    { M_LDA, AM_ZP, 3, 0 },
+    { M_LDX, AM_ZP, 3, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_TAY, AM_IMP, 2, 0 },
+    { M_LDA, AM_IMM, 2, 0 },
+    { M_TAX, AM_IMP, 2, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_LDY, AM_ABS, 4, 0 },
+    { M_LDA, AM_ABS, 4, 0 },
+    { M_LDX, AM_ABS, 4, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    /* $B0 */
+    { M_BCS, AM_REL, 2, 0 },
+    { M_LDA, AM_IZY, 5, 1 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_LDY, AM_ZPX, 4, 0 },
+    { M_LDA, AM_ZPX, 4, 0 },
+    { M_LDX, AM_ZPY, 4, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_CLV, AM_IMP, 2, 0 },
+    { M_LDA, AM_ABY, 4, 1 },
+    { M_TSX, AM_IMP, 2, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_LDY, AM_ABX, 4, 1 },
+    { M_LDA, AM_ABX, 4, 1 },
+    { M_LDX, AM_ABY, 4, 1 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    /* $C0 */
+    { M_CPY, AM_IMM, 2, 0 },
+    { M_CMP, AM_IZX, 6, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_CPY, AM_ZP, 3, 0 },
+    { M_CMP, AM_ZP, 3, 0 },
+    { M_DEC, AM_ZP, 5, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_INY, AM_IMP, 2, 0 },
+    { M_CMP, AM_IMM, 2, 0 },
+    { M_DEX, AM_IMP, 2, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_CPY, AM_ABS, 4, 0 },
+    { M_CMP, AM_ABS, 4, 0 },
+    { M_DEC, AM_ABS, 6, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    /* $D0 */
+    { M_BNE, AM_REL, 2, 0 },
+    { M_CMP, AM_IZY, 5, 1 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_CMP, AM_ZPX, 4, 0 },
+    { M_DEC, AM_ZPX, 6, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_CLD, AM_IMP, 2, 0 },
+    { M_CMP, AM_ABY, 4, 1 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_CMP, AM_ABX, 4, 1 },
+    { M_DEC, AM_ABX, 7, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    /* $E0 */
+    { M_CPX, AM_IMM, 2, 0 },
+    { M_SBC, AM_IZX, 6, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_CPX, AM_ZP, 3, 0 },
+    { M_SBC, AM_ZP, 3, 0 },
+    { M_INC, AM_ZP, 5, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_INX, AM_IMP, 2, 0 },
+    { M_SBC, AM_IMM, 2, 0 },
+    { M_NOP, AM_IMP, 2, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_CPX, AM_ABS, 4, 0 },
+    { M_SBC, AM_ABS, 4, 0 },
+    { M_INC, AM_ABS, 6, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    /* $F0 */
+    { M_BEQ, AM_REL, 2, 0 },
+    { M_SBC, AM_IZY, 5, 1 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_SBC, AM_ZPX, 4, 0 },
+    { M_INC, AM_ZPX, 6, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_SED, AM_IMP, 2, 0 },
+    { M_SBC, AM_ABY, 4, 1 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+    { M_SBC, AM_ABX, 4, 1 },
+    { M_INC, AM_ABX, 7, 0 },
+    { M_ILLEGAL, AM_IMP, 0, 0 },
+};
+
+#endif // m6502.h
@@ -0,0 +1,1144 @@
+//--------------------------------------------------------//
+//        Dragon's Leap - harness de emulação da PPU      //
+//--------------------------------------------------------//
+//
+// Ferramenta do host (não roda no NES). Executa a ROM num 6502 com a
+// temporização da PPU NTSC (341 pontos x 262 linhas, 3 pontos por ciclo
+// de CPU) e o mapper MMC3, sem desenhar nada, e:
+//   - registra cada escrita nos registradores da PPU com o quadro, a linha
+//     e o ponto em que aconteceu (--log);
+//   - acusa escritas em $2003/$2004/$2006/$2007/$4014 com a renderização
+//     ligada fora do vblank, separando o NMI que passou do vblank de
+//     escritas feitas pelo código principal;
+//   - mede, em cada quadro, quantos ciclos do vblank o NMI usou até a
+//     última escrita na PPU e quantos sobraram, e quanto o NMI levou até
+//     o RTI (o que inclui o áudio);
+//   - com o mapfile (--map), mede cada chamada do famitone_update;
+//   - imprime histogramas em texto fixo, para comparar (diff) entre builds.
+//
+// O sprite zero colide na primeira linha e coluna do sprite (o jogo o põe
+// sobre um tile opaco). Sem APU: o som não é emulado.
+//
+// Compilar:  cc -O2 -o tools/nes_trace tools/nes_trace.c
+// Uso:       tools/nes_trace [-n quadros] [--log arquivo] [--dump arquivo]
+//                            [--input roteiro | --random semente]
+//                            [--splits linha,...] [--map mapfile] rom.nes
+//   --dump:  grava o estado da PPU de cada quadro (tools/ppu_dump.h) para o
+//            tools/ppu_render.c desenhar
+//   roteiro: "quadro:BOTÕES,..." com BOTÕES em A B SELECT START UP DOWN LEFT
+//            RIGHT unidos por "+", ex. "30:START,100:A+RIGHT"; cada entrada
+//            segura os botões por 2 quadros. Sem roteiro, aperta START a cada
+//            256 quadros e A a cada 24 (passa por título, jogo, batida e recomeço).
+//   --random: botões sorteados a cada 4 quadros a partir da semente (A em
+//            um terço deles, START em 1/64), para jogar sozinho por muitos
+//            quadros com as invariantes ligadas; a mesma semente repete a partida.
+//
+// Porta de teste (hotpath.h): a ROM escreve em TEST_PORT para marcar o
+// início e o fim de chamadas medidas e as divergências do HOTPATH_SELFTEST;
+// no fim sai a tabela de ciclos de cada rotina, C (2n) x assembly (2n+1).
+// Os ciclos vão da escrita de início à de fim e incluem a passagem dos
+// argumentos e o jsr. As falhas a partir de TEST_INVARIANT são as
+// invariantes do jogo (CHECK_INVARIANTS), listadas com o primeiro quadro.
+//
+// --splits: scanlines pedidos ao raster_add() a cada quadro, em ordem (os
+// de parallax_layers[] em dragons_leap.c, ex. "208"). Cada escrita do scroll
+// X feita dentro da IRQ é um split; a linha em que ele vale é a primeira
+// cuja cópia do ponto 257 (a mesma do line_x do --dump) acontece depois da
+// escrita. O n-ésimo split do quadro tem de valer no n-ésimo scanline.
+//
+// --map: mapfile do ld65 da mesma build (-m). Cada chamada do
+// _famitone_update é medida da primeira instrução ao rts que volta para
+// quem chamou, separando as do NMI (o jmp no fim do callback de raster.s)
+// das adiadas para depois do split (audio_update_deferred()); numa chamada
+// adiada não contam os ciclos das IRQs e do NMI que a interrompem. O
+// relatório traz o máximo de cada caminho com o quadro, a medida para o
+// AUDIO_UPDATE_CYCLES (audio.h) e o cost do tools/wcet.txt.
+//
+// Sai com código 1 se houve escrita fora do vblank, divergência no teste,
+// invariante violada ou split fora da linha.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "m6502.h"
+#include "ppu_dump.h"
+
+#define DEFAULT_FRAMES  3600
+#define MAX_REPORTS     40
+#define MAX_INPUTS      256
+#define MAX_SPLITS      4           // RASTER_MAX_SPLITS (raster.h)
+
+// Temporização NTSC
+#define DOTS_PER_LINE   341
+#define LINES_PER_FRAME 262
+#define VBLANK_LINE     241
+#define PRERENDER_LINE  261
+#define VBLANK_CYCLES   ((20 * DOTS_PER_LINE) / 3)     // 2273 ciclos de CPU
+
+// Histogramas
+#define UPLOAD_BUCKET   128
+#define UPLOAD_BUCKETS  19          // 0..2431, o último acumula o resto
+#define NMI_BUCKET      256
+#define NMI_BUCKETS     24          // 0..6143
+
+// Porta de teste (ver hotpath.h)
+#define TEST_PORT       0x5FFF
+#define TEST_END        0x40
+#define TEST_FAIL       0x80
+#define TEST_DONE       0xFF
+#define TEST_ROUTINES   32
+#define TEST_INVARIANT  16
+
+
+//--------------------------------------------------------//
+//                    CARTUCHO                            //
+//--------------------------------------------------------//
+
+static uint8_t* prg;
+static uint32_t prg_size;
+static uint8_t chr[0x2000];
+static int chr_is_ram;
+static int mapper;
+static int vertical_mirroring;
+
+static uint8_t ram[0x800];
+static uint8_t prg_ram[0x2000];
+
+// MMC3
+static uint8_t mmc3_select;
+static uint8_t mmc3_regs[8];
+static uint8_t mmc3_irq_latch;
+static uint8_t mmc3_irq_counter;
+static int mmc3_irq_reload;
+static int mmc3_irq_enabled;
+static int irq_line;
+
+static uint8_t prg_read(uint16_t a) {
+    uint32_t banks = prg_size / 0x2000;
+    uint32_t bank;
+
+    if (mapper == 0) {
+        return prg[(a - 0x8000) % prg_size];
+    }
+    switch ((a >> 13) & 3) {
+        case 0:  bank = (mmc3_select & 0x40) ? banks - 2 : mmc3_regs[6]; break;
+        case 1:  bank = mmc3_regs[7]; break;
+        case 2:  bank = (mmc3_select & 0x40) ? mmc3_regs[6] : banks - 2; break;
+        default: bank = banks - 1; break;
+    }
+    return prg[(bank % banks) * 0x2000 + (a & 0x1FFF)];
+}
+
+static void mapper_write(uint16_t a, uint8_t v) {
+    if (mapper != 4) return;
+    switch (a & 0xE001) {
+        case 0x8000: mmc3_select = v; break;
+        case 0x8001: mmc3_regs[mmc3_select & 7] = v; break;
+        case 0xA000: vertical_mirroring = !(v & 1); break;
+        case 0xC000: mmc3_irq_latch = v; break;
+        case 0xC001: mmc3_irq_counter = 0; mmc3_irq_reload = 1; break;
+        case 0xE000: mmc3_irq_enabled = 0; irq_line = 0; break;
+        case 0xE001: mmc3_irq_enabled = 1; break;
+    }
+}
+
+// Borda de subida de A12 (BG em $0000, sprites em $1000): uma vez por linha
+static void mmc3_clock(void) {
+    if (mmc3_irq_counter == 0 || mmc3_irq_reload) {
+        mmc3_irq_counter = mmc3_irq_latch;
+        mmc3_irq_reload = 0;
+    } else {
+        mmc3_irq_counter--;
+    }
+    if (mmc3_irq_counter == 0 && mmc3_irq_enabled) {
+        irq_line = 1;
+    }
+}
+
+
+//--------------------------------------------------------//
+//                      PPU                               //
+//--------------------------------------------------------//
+
+static uint8_t ppu_ctrl, ppu_mask, ppu_status;
+static uint8_t oam_addr;
+static uint8_t oam[256];
+static uint8_t nametables[0x800];
+static uint8_t palette[32];
+static uint16_t ppu_v, ppu_t;
+static uint8_t ppu_fine_x;
+static int ppu_w;
+static uint8_t ppu_read_buffer;
+
+static int scanline = 0, dot = 0;
+static uint64_t ppu_dots;
+static int nmi_pending;
+
+static uint64_t cpu_cycles;
+static uint64_t access_time;    // ciclo do acesso ao barramento em andamento
+static uint16_t instr_pc;
+
+static uint64_t frame;
+static uint64_t frames_wanted = DEFAULT_FRAMES;
+static FILE* log_file;
+static FILE* dump_file;
+static PpuDump dump;            // quadro em andamento, gravado no início do vblank
+
+#define RENDERING() (ppu_mask & 0x18)
+
+static uint16_t nametable_index(uint16_t a) {
+    a &= 0x0FFF;
+    if (vertical_mirroring) return a & 0x07FF;
+    return ((a >> 1) & 0x0400) | (a & 0x03FF);
+}
+
+static void vram_write(uint16_t a, uint8_t v) {
+    a &= 0x3FFF;
+    if (a < 0x2000) {
+        if (chr_is_ram) chr[a] = v;
+    } else if (a < 0x3F00) {
+        nametables[nametable_index(a)] = v;
+    } else {
+        a &= 0x1F;
+        if ((a & 0x13) == 0x10) a &= 0x0F;
+        palette[a] = v;
+    }
+}
+
+static uint8_t vram_read(uint16_t a) {
+    a &= 0x3FFF;
+    if (a < 0x2000) return chr[a];
+    if (a < 0x3F00) return nametables[nametable_index(a)];
+    a &= 0x1F;
+    if ((a & 0x13) == 0x10) a &= 0x0F;
+    return palette[a];
+}
+
+
+//--------------------------------------------------------//
+//                 MEDIÇÃO POR QUADRO                     //
+//--------------------------------------------------------//
+
+static uint64_t vblank_start;           // ciclo de CPU do início do vblank
+static int64_t upload_used;             // ciclos até a última escrita na PPU (-1 = nenhuma)
+static int frame_rendering;             // a PPU estava ligada no início do vblank
+static int in_nmi;
+static uint8_t nmi_sp;
+static uint64_t nmi_start;
+static int64_t nmi_cycles;              // duração do último NMI até o RTI
+
+static uint32_t upload_hist[UPLOAD_BUCKETS];
+static uint32_t nmi_hist[NMI_BUCKETS];
+static int64_t upload_max = -1, nmi_max = -1;
+static uint64_t upload_max_frame, nmi_max_frame;
+static uint64_t frames_measured, frames_dark, frames_no_upload;
+
+static uint64_t bad_in_nmi, bad_outside_nmi, reports;
+
+static int in_irq;
+static uint8_t irq_sp;
+static int split_lines[MAX_SPLITS];
+static int split_count = -1;            // -1 = sem --splits
+static int split_next;                  // próximo split do quadro
+static uint64_t splits_checked, splits_bad;
+
+// famitone_update (--map)
+typedef struct {
+    uint64_t calls;
+    int64_t max;
+    uint64_t max_frame, first_frame;
+} AudioStats;
+
+static int audio_addr = -1;
+static int audio_active;                // dentro de uma chamada medida
+static int audio_from_nmi;
+static uint8_t audio_sp;                // S na entrada: o rts de volta o encontra igual
+static uint64_t audio_start, audio_skipped;
+static AudioStats audio_nmi, audio_deferred;
+
+typedef struct {
+    uint64_t calls, total, min, max, fails;
+    uint64_t first_fail;        // quadro da primeira falha
+} TestStats;
+
+static TestStats tests[TEST_ROUTINES];
+static int test_current = -1;
+static uint64_t test_start;
+static int test_done;
+
+static int in_vblank(void) {
+    return (scanline >= VBLANK_LINE && scanline < PRERENDER_LINE)
+        || (scanline == PRERENDER_LINE && dot == 0);
+}
+
+static void end_of_frame_stats(void) {
+    if (!frame_rendering) {
+        frames_dark++;
+        return;
+    }
+    frames_measured++;
+    if (upload_used < 0) {
+        frames_no_upload++;
+    } else {
+        int b = (int)(upload_used / UPLOAD_BUCKET);
+        upload_hist[b < UPLOAD_BUCKETS ? b : UPLOAD_BUCKETS - 1]++;
+        if (upload_used > upload_max) {
+            upload_max = upload_used;
+            upload_max_frame = frame;
+        }
+    }
+    if (nmi_cycles >= 0) {
+        int b = (int)(nmi_cycles / NMI_BUCKET);
+        nmi_hist[b < NMI_BUCKETS ? b : NMI_BUCKETS - 1]++;
+        if (nmi_cycles > nmi_max) {
+            nmi_max = nmi_cycles;
+            nmi_max_frame = frame;
+        }
+    }
+}
+
+static void write_dump(void) {
+    dump.magic = PPU_DUMP_MAGIC;
+    dump.frame = (uint32_t)frame;
+    dump.flags = (vertical_mirroring ? PPU_DUMP_VERTICAL : 0) | (chr_is_ram ? PPU_DUMP_CHR : 0);
+    memcpy(dump.nametables, nametables, sizeof(dump.nametables));
+    memcpy(dump.palette, palette, sizeof(dump.palette));
+    memcpy(dump.oam, oam, sizeof(dump.oam));
+    fwrite(&dump, sizeof(dump), 1, dump_file);
+    if (chr_is_ram) fwrite(chr, sizeof(chr), 1, dump_file);
+}
+
+static void vblank_begin(void) {
+    if (dump_file && frame) write_dump();
+    if (frame) end_of_frame_stats();
+    frame++;
+    split_next = 0;
+    vblank_start = ppu_dots / 3;
+    upload_used = -1;
+    nmi_cycles = -1;
+    frame_rendering = RENDERING() != 0;
+}
+
+// Uma escrita de upload (VRAM, OAM) que termina no ciclo "end"
+static void note_upload(uint16_t reg, uint8_t v, uint64_t end) {
+    if (in_vblank()) {
+        int64_t used = (int64_t)(end - vblank_start);
+        if (used > upload_used) upload_used = used;
+        return;
+    }
+    if (!RENDERING()) return;
+
+    if (in_nmi) bad_in_nmi++;
+    else bad_outside_nmi++;
+    if (reports++ < MAX_REPORTS) {
+        printf("quadro %llu linha %d ponto %d pc $%04X: $%04X <- $%02X com a renderização ligada (%s)\n",
+               (unsigned long long)frame, scanline, dot, instr_pc, reg, v,
+               in_nmi ? "NMI passou do vblank" : "fora do NMI");
+    }
+}
+
+// Escrita do scroll X dentro da IRQ: confere a linha em que o split vale
+static void note_split(uint8_t v) {
+    int line = scanline + (dot < 257 ? 1 : 2);
+
+    if (split_count < 0 || !RENDERING()) return;
+    splits_checked++;
+    if (split_next < split_count && line == split_lines[split_next]) {
+        split_next++;
+        return;
+    }
+    splits_bad++;
+    if (reports++ < MAX_REPORTS) {
+        if (split_next < split_count) {
+            printf("quadro %llu split %d (scroll %d): vale na linha %d, pedido na %d\n",
+                   (unsigned long long)frame, split_next, v, line, split_lines[split_next]);
+        } else {
+            printf("quadro %llu split %d (scroll %d): vale na linha %d, além dos %d pedidos\n",
+                   (unsigned long long)frame, split_next, v, line, split_count);
+        }
+    }
+    split_next++;
+}
+
+
+//--------------------------------------------------------//
+//               AVANÇO DA PPU                            //
+//--------------------------------------------------------//
+
+static void ppu_dot(void) {
+    if (++dot == DOTS_PER_LINE) {
+        dot = 0;
+        if (++scanline == LINES_PER_FRAME) scanline = 0;
+    }
+    ppu_dots++;
+
+    if (dot == 1) {
+        if (scanline == VBLANK_LINE) {
+            ppu_status |= 0x80;
+            vblank_begin();
+            if (ppu_ctrl & 0x80) nmi_pending = 1;
+        } else if (scanline == PRERENDER_LINE) {
+            ppu_status &= ~0xE0;
+        }
+    }
+
+    // Scroll horizontal da próxima linha (cópia de t para v no ponto 257)
+    // e vertical do quadro (pré-render), para o --dump
+    if (dot == 257 && (scanline < 239 || scanline == PRERENDER_LINE)) {
+        int next = scanline == PRERENDER_LINE ? 0 : scanline + 1;
+        dump.line_x[next] = ((ppu_t & 0x0400) ? 256 : 0) | ((ppu_t & 0x1F) << 3) | ppu_fine_x;
+        dump.line_ctrl[next] = ppu_ctrl;
+        dump.line_mask[next] = ppu_mask;
+    } else if (dot == 280 && scanline == PRERENDER_LINE) {
+        dump.scroll_y = ((ppu_t & 0x0800) ? 240 : 0) | (((ppu_t >> 5) & 0x1F) << 3) | ((ppu_t >> 12) & 7);
+    }
+
+    if (!RENDERING()) return;
+
+    // Sprite zero: na primeira linha e coluna do sprite, com BG e sprites ligados
+    if ((ppu_mask & 0x18) == 0x18 && !(ppu_status & 0x40) && scanline < 240
+        && oam[0] < 239 && scanline == oam[0] + 1 && dot == oam[3] + 1
+        && (oam[3] >= 8 || (ppu_mask & 0x06) == 0x06) && oam[3] != 255) {
+        ppu_status |= 0x40;
+    }
+
+    if (dot == 260 && (scanline < 240 || scanline == PRERENDER_LINE) && mapper == 4) {
+        mmc3_clock();
+    }
+}
+
+static void ppu_catch_up(uint64_t cycle) {
+    while (ppu_dots < cycle * 3) ppu_dot();
+}
+
+static void log_write(uint16_t reg, uint8_t v) {
+    if (log_file) {
+        fprintf(log_file, "%llu %3d %3d $%04X $%04X %02X\n",
+                (unsigned long long)frame, scanline, dot, instr_pc, reg, v);
+    }
+}
+
+static uint8_t ppu_reg_read(uint16_t a) {
+    uint8_t v = 0;
+
+    ppu_catch_up(access_time);
+    switch (a & 7) {
+        case 2:
+            v = ppu_status;
+            ppu_status &= ~0x80;
+            ppu_w = 0;
+            break;
+        case 4:
+            v = oam[oam_addr];
+            break;
+        case 7:
+            v = ppu_read_buffer;
+            ppu_read_buffer = vram_read(ppu_v);
+            if ((ppu_v & 0x3FFF) >= 0x3F00) v = ppu_read_buffer;
+            ppu_v += (ppu_ctrl & 4) ? 32 : 1;
+            break;
+    }
+    return v;
+}
+
+static void ppu_reg_write(uint16_t a, uint8_t v) {
+    uint16_t reg = 0x2000 | (a & 7);
+
+    ppu_catch_up(access_time);
+    log_write(reg, v);
+
+    switch (a & 7) {
+        case 0:
+            if (!(ppu_ctrl & 0x80) && (v & 0x80) && (ppu_status & 0x80)) nmi_pending = 1;
+            ppu_ctrl = v;
+            ppu_t = (ppu_t & 0xF3FF) | ((v & 3) << 10);
+            break;
+        case 1:
+            ppu_mask = v;
+            break;
+        case 3:
+            oam_addr = v;
+            note_upload(reg, v, access_time);
+            break;
+        case 4:
+            oam[oam_addr++] = v;
+            note_upload(reg, v, access_time);
+            break;
+        case 5:
+            if (!ppu_w) {
+                ppu_t = (ppu_t & ~0x001F) | (v >> 3);
+                ppu_fine_x = v & 7;
+                if (in_irq) note_split(v);
+            } else {
+                ppu_t = (ppu_t & ~0x73E0) | ((v & 7) << 12) | ((v & 0xF8) << 2);
+            }
+            ppu_w ^= 1;
+            break;
+        case 6:
+            if (!ppu_w) {
+                ppu_t = (ppu_t & 0x00FF) | ((v & 0x3F) << 8);
+            } else {
+                ppu_t = (ppu_t & 0xFF00) | v;
+                ppu_v = ppu_t;
+            }
+            ppu_w ^= 1;
+            note_upload(reg, v, access_time);
+            break;
+        case 7:
+            vram_write(ppu_v, v);
+            ppu_v += (ppu_ctrl & 4) ? 32 : 1;
+            note_upload(reg, v, access_time);
+            break;
+    }
+}
+
+
+//--------------------------------------------------------//
+//                  CONTROLE                              //
+//--------------------------------------------------------//
+
+typedef struct {
+    uint64_t frame;
+    uint8_t buttons;
+} InputEvent;
+
+static InputEvent inputs[MAX_INPUTS];
+static int ninputs = -1;            // -1 = roteiro automático
+static int random_input;
+static uint32_t random_seed;
+static uint8_t pad_shift;
+static int pad_strobe;
+
+static uint8_t buttons_now(void) {
+    int i;
+
+    if (random_input) {
+        // hash da semente com o bloco de 4 quadros (xorshift32 + mistura)
+        uint32_t r = random_seed ^ (uint32_t)(frame / 4) * 0x9E3779B9u;
+        uint8_t b = 0;
+        r ^= r << 13;
+        r ^= r >> 17;
+        r ^= r << 5;
+        r *= 0x85EBCA6Bu;
+        r ^= r >> 16;
+        if (r % 3 == 0) b |= 0x01;                              // A
+        if ((r >> 8) % 64 == 0) b |= 0x08;                      // START
+        return b | ((r >> 20) & 0xF0);                          // direções
+    }
+    if (ninputs < 0) {
+        uint8_t b = 0;
+        if (frame % 256 >= 60 && frame % 256 < 62) b |= 0x08;   // START
+        if (frame % 24 < 2) b |= 0x01;                          // A
+        return b;
+    }
+    for (i = 0; i < ninputs; i++) {
+        if (frame >= inputs[i].frame && frame < inputs[i].frame + 2) return inputs[i].buttons;
+    }
+    return 0;
+}
+
+static void parse_inputs(const char* spec) {
+    static const char* names[8] = { "A", "B", "SELECT", "START", "UP", "DOWN", "LEFT", "RIGHT" };
+    char buf[4096];
+    char* item;
+
+    strncpy(buf, spec, sizeof(buf) - 1);
+    ninputs = 0;
+    for (item = strtok(buf, ","); item && ninputs < MAX_INPUTS; item = strtok(NULL, ",")) {
+        char* colon = strchr(item, ':');
+        char* name;
+        if (!colon) continue;
+        *colon = 0;
+        inputs[ninputs].frame = strtoull(item, NULL, 0);
+        inputs[ninputs].buttons = 0;
+        for (name = strtok_r(colon + 1, "+", &colon); name; name = strtok_r(NULL, "+", &colon)) {
+            int b;
+            for (b = 0; b < 8; b++) {
+                if (!strcmp(name, names[b])) inputs[ninputs].buttons |= 1 << b;
+            }
+        }
+        ninputs++;
+    }
+}
+
+// Endereço de "name" na lista "Exports list by name:" do mapfile (trios
+// nome, valor, flags por linha), como no tools/wcet.c
+static int map_symbol(const char* path, const char* name) {
+    char line[512];
+    int in_exports = 0, seen = 0, addr = -1;
+    FILE* f = fopen(path, "r");
+
+    if (!f) {
+        perror(path);
+        exit(2);
+    }
+    while (addr < 0 && fgets(line, sizeof(line), f)) {
+        char sym[64], flags[16];
+        unsigned value;
+        char* p = line;
+        int n;
+
+        if (!strncmp(line, "Exports list", 12)) {
+            in_exports = 1;
+            continue;
+        }
+        if (!in_exports || line[0] == '-') continue;
+        if (line[0] == '\n' || line[0] == '\r') {
+            if (seen) in_exports = 0;      // fim da lista
+            continue;
+        }
+        while (sscanf(p, "%63s %x %15s%n", sym, &value, flags, &n) == 3) {
+            seen = 1;
+            if (!strcmp(sym, name)) {
+                addr = (int)value;
+                break;
+            }
+            p += n;
+        }
+    }
+    fclose(f);
+    if (addr < 0) {
+        fprintf(stderr, "%s: %s não está no mapfile\n", path, name);
+        exit(2);
+    }
+    return addr;
+}
+
+static void parse_splits(const char* spec) {
+    char buf[256];
+    char* item;
+
+    strncpy(buf, spec, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = 0;
+    split_count = 0;
+    for (item = strtok(buf, ","); item && split_count < MAX_SPLITS; item = strtok(NULL, ",")) {
+        split_lines[split_count++] = (int)strtol(item, NULL, 0);
+    }
+}
+
+
+//--------------------------------------------------------//
+//                   BARRAMENTO                           //
+//--------------------------------------------------------//
+
+static uint8_t A, X, Y, S, P;
+static uint16_t PC;
+
+#define FLAG_C 0x01
+#define FLAG_Z 0x02
+#define FLAG_I 0x04
+#define FLAG_D 0x08
+#define FLAG_B 0x10
+#define FLAG_U 0x20
+#define FLAG_V 0x40
+#define FLAG_N 0x80
+
+static uint8_t bus_read(uint16_t a) {
+    if (a < 0x2000) return ram[a & 0x7FF];
+    if (a < 0x4000) return ppu_reg_read(a);
+    if (a == 0x4016) {
+        uint8_t v = pad_shift & 1;
+        if (!pad_strobe) pad_shift = (pad_shift >> 1) | 0x80;
+        return v | 0x40;
+    }
+    if (a < 0x6000) return 0;
+    if (a < 0x8000) return prg_ram[a & 0x1FFF];
+    return prg_read(a);
+}
+
+static void test_port_write(uint8_t v) {
+    if (v == TEST_DONE) {
+        test_done = 1;
+    } else if (v & TEST_FAIL) {
+        TestStats* t = &tests[v & (TEST_ROUTINES - 1)];
+        if (!t->fails) t->first_fail = frame;
+        t->fails++;
+    } else if (v == TEST_END) {
+        if (test_current >= 0) {
+            TestStats* t = &tests[test_current];
+            uint64_t c = access_time - test_start;
+            if (!t->calls || c < t->min) t->min = c;
+            if (c > t->max) t->max = c;
+            t->total += c;
+            t->calls++;
+            test_current = -1;
+        }
+    } else {
+        test_current = v & (TEST_ROUTINES - 1);
+        test_start = access_time;
+    }
+}
+
+static void print_tests(void) {
+    uint64_t fails = 0;
+    int n, routines = 0;
+
+    for (n = 0; n < TEST_INVARIANT; n++) {
+        if (tests[n].calls || tests[n].fails) routines = 1;
+    }
+    if (routines) {
+        printf("rotina  versão   chamadas   média  mínimo  máximo  divergências\n");
+        for (n = 0; n < TEST_INVARIANT; n++) {
+            const TestStats* t = &tests[n];
+            fails += t->fails;
+            if (!t->calls && !t->fails) continue;
+            printf("%6d  %-7s  %8llu  %6llu  %6llu  %6llu  %llu\n", n / 2, (n & 1) ? "asm" : "C",
+                   (unsigned long long)t->calls,
+                   (unsigned long long)(t->calls ? t->total / t->calls : 0),
+                   (unsigned long long)t->min, (unsigned long long)t->max,
+                   (unsigned long long)t->fails);
+        }
+        printf("teste %s, %llu divergências\n", test_done ? "completo" : "incompleto",
+               (unsigned long long)fails);
+    }
+    for (n = TEST_INVARIANT; n < TEST_ROUTINES; n++) {
+        if (!tests[n].fails) continue;
+        printf("invariante %d: %llu violações, a primeira no quadro %llu\n", n - TEST_INVARIANT,
+               (unsigned long long)tests[n].fails, (unsigned long long)tests[n].first_fail);
+    }
+}
+
+static void audio_begin(void) {
+    audio_active = 1;
+    audio_from_nmi = in_nmi;
+    audio_sp = S;
+    audio_start = cpu_cycles;
+    audio_skipped = 0;
+}
+
+static void audio_end(uint64_t end) {
+    AudioStats* a = audio_from_nmi ? &audio_nmi : &audio_deferred;
+    int64_t c = (int64_t)(end - audio_start - audio_skipped);
+
+    if (!a->calls++) a->first_frame = frame;
+    if (c > a->max) {
+        a->max = c;
+        a->max_frame = frame;
+    }
+    audio_active = 0;
+}
+
+static void print_audio(const char* title, const AudioStats* a) {
+    if (!a->calls) {
+        printf("%s: nenhuma chamada\n", title);
+        return;
+    }
+    printf("%s: %llu chamadas (a primeira no quadro %llu), máximo %lld ciclos (quadro %llu)\n",
+           title, (unsigned long long)a->calls, (unsigned long long)a->first_frame,
+           (long long)a->max, (unsigned long long)a->max_frame);
+}
+
+static int test_failed(void) {
+    int n;
+    for (n = 0; n < TEST_ROUTINES; n++) {
+        if (tests[n].fails) return 1;
+    }
+    return 0;
+}
+
+static void bus_write(uint16_t a, uint8_t v) {
+    if (a < 0x2000) {
+        ram[a & 0x7FF] = v;
+    } else if (a < 0x4000) {
+        ppu_reg_write(a, v);
+    } else if (a == 0x4014) {
+        uint16_t src = v << 8;
+        int i;
+        ppu_catch_up(access_time);
+        log_write(0x4014, v);
+        for (i = 0; i < 256; i++) oam[(oam_addr + i) & 0xFF] = bus_read(src + i);
+        // A CPU fica parada 513 ciclos (514 em ciclo ímpar)
+        cpu_cycles += 513 + (cpu_cycles & 1);
+        note_upload(0x4014, v, cpu_cycles);
+    } else if (a == 0x4016) {
+        pad_strobe = v & 1;
+        if (pad_strobe) pad_shift = buttons_now();
+    } else if (a == TEST_PORT) {
+        test_port_write(v);
+    } else if (a >= 0x6000 && a < 0x8000) {
+        prg_ram[a & 0x1FFF] = v;
+    } else if (a >= 0x8000) {
+        mapper_write(a, v);
+    }
+}
+
+
+//--------------------------------------------------------//
+//                      CPU                               //
+//--------------------------------------------------------//
+
+static void push(uint8_t v) {
+    ram[0x100 | S--] = v;
+}
+
+static uint8_t pull(void) {
+    return ram[0x100 | ++S];
+}
+
+static void set_zn(uint8_t v) {
+    P = (P & ~(FLAG_Z | FLAG_N)) | (v ? 0 : FLAG_Z) | (v & FLAG_N);
+}
+
+static void interrupt(uint16_t vector) {
+    push(PC >> 8);
+    push(PC & 0xFF);
+    push((P & ~FLAG_B) | FLAG_U);
+    P |= FLAG_I;
+    PC = bus_read(vector) | (bus_read(vector + 1) << 8);
+    cpu_cycles += 7;
+}
+
+static void adc(uint8_t v) {
+    uint16_t sum = A + v + (P & FLAG_C);
+    P &= ~(FLAG_C | FLAG_V);
+    if (sum > 0xFF) P |= FLAG_C;
+    if (~(A ^ v) & (A ^ sum) & 0x80) P |= FLAG_V;
+    A = (uint8_t)sum;
+    set_zn(A);
+}
+
+static void compare(uint8_t r, uint8_t v) {
+    P = (P & ~FLAG_C) | (r >= v ? FLAG_C : 0);
+    set_zn((uint8_t)(r - v));
+}
+
+static void branch(int cond, uint16_t target, int* extra) {
+    if (!cond) return;
+    *extra += ((PC ^ target) & 0xFF00) ? 2 : 1;
+    PC = target;
+}
+
+// Executa uma instrução; retorna 0 em opcode ilegal
+static int cpu_step(void) {
+    uint8_t opcode = bus_read(PC);
+    const M6502Op* o = &m6502_ops[opcode];
+    uint16_t ea = 0, base;
+    uint8_t v, z;
+    int extra = 0;
+    uint64_t step_start = cpu_cycles;
+    // Instrução de uma interrupção no meio de um famitone_update adiado
+    int audio_interrupted = audio_active && !audio_from_nmi && (in_nmi || in_irq);
+
+    if (o->op == M_ILLEGAL) return 0;
+    if (!audio_active && PC == audio_addr) audio_begin();
+
+    instr_pc = PC++;
+    switch (o->mode) {
+        case AM_IMM: ea = PC++; break;
+        case AM_ZP:  ea = bus_read(PC++); break;
+        case AM_ZPX: ea = (uint8_t)(bus_read(PC++) + X); break;
+        case AM_ZPY: ea = (uint8_t)(bus_read(PC++) + Y); break;
+        case AM_ABS:
+            ea = bus_read(PC) | (bus_read(PC + 1) << 8);
+            PC += 2;
+            break;
+        case AM_ABX:
+        case AM_ABY:
+            base = bus_read(PC) | (bus_read(PC + 1) << 8);
+            PC += 2;
+            ea = base + (o->mode == AM_ABX ? X : Y);
+            if (o->page && ((base ^ ea) & 0xFF00)) extra = 1;
+            break;
+        case AM_IND:
+            base = bus_read(PC) | (bus_read(PC + 1) << 8);
+            PC += 2;
+            ea = bus_read(base) | (bus_read((base & 0xFF00) | ((base + 1) & 0xFF)) << 8);
+            break;
+        case AM_IZX:
+            z = bus_read(PC++) + X;
+            ea = ram[z] | (ram[(uint8_t)(z + 1)] << 8);
+            break;
+        case AM_IZY:
+            z = bus_read(PC++);
+            base = ram[z] | (ram[(uint8_t)(z + 1)] << 8);
+            ea = base + Y;
+            if (o->page && ((base ^ ea) & 0xFF00)) extra = 1;
+            break;
+        case AM_REL:
+            v = bus_read(PC++);
+            ea = PC + (int8_t)v;
+            break;
+    }
+
+    // Leituras e escritas na PPU acontecem no último ciclo da instrução
+    access_time = cpu_cycles + o->cycles + extra - 1;
+
+    switch (o->op) {
+        case M_ADC: adc(bus_read(ea)); break;
+        case M_SBC: adc(bus_read(ea) ^ 0xFF); break;
+        case M_AND: A &= bus_read(ea); set_zn(A); break;
+        case M_ORA: A |= bus_read(ea); set_zn(A); break;
+        case M_EOR: A ^= bus_read(ea); set_zn(A); break;
+
+        case M_ASL: case M_LSR: case M_ROL: case M_ROR: {
+            uint8_t c = P & FLAG_C;
+            v = o->mode == AM_ACC ? A : bus_read(ea);
+            switch (o->op) {
+                case M_ASL: P = (P & ~FLAG_C) | (v >> 7); v <<= 1; break;
+                case M_LSR: P = (P & ~FLAG_C) | (v & 1); v >>= 1; break;
+                case M_ROL: P = (P & ~FLAG_C) | (v >> 7); v = (v << 1) | c; break;
+                default:    P = (P & ~FLAG_C) | (v & 1); v = (v >> 1) | (c << 7); break;
+            }
+            set_zn(v);
+            if (o->mode == AM_ACC) A = v; else bus_write(ea, v);
+            break;
+        }
+
+        case M_BIT:
+            v = bus_read(ea);
+            P = (P & ~(FLAG_Z | FLAG_V | FLAG_N)) | (v & (FLAG_V | FLAG_N)) | ((A & v) ? 0 : FLAG_Z);
+            break;
+
+        case M_BCC: branch(!(P & FLAG_C), ea, &extra); break;
+        case M_BCS: branch(P & FLAG_C, ea, &extra); break;
+        case M_BNE: branch(!(P & FLAG_Z), ea, &extra); break;
+        case M_BEQ: branch(P & FLAG_Z, ea, &extra); break;
+        case M_BPL: branch(!(P & FLAG_N), ea, &extra); break;
+        case M_BMI: branch(P & FLAG_N, ea, &extra); break;
+        case M_BVC: branch(!(P & FLAG_V), ea, &extra); break;
+        case M_BVS: branch(P & FLAG_V, ea, &extra); break;
+
+        case M_BRK:
+            PC++;
+            push(PC >> 8);
+            push(PC & 0xFF);
+            push(P | FLAG_B | FLAG_U);
+            P |= FLAG_I;
+            PC = bus_read(0xFFFE) | (bus_read(0xFFFF) << 8);
+            break;
+
+        case M_CLC: P &= ~FLAG_C; break;
+        case M_CLD: P &= ~FLAG_D; break;
+        case M_CLI: P &= ~FLAG_I; break;
+        case M_CLV: P &= ~FLAG_V; break;
+        case M_SEC: P |= FLAG_C; break;
+        case M_SED: P |= FLAG_D; break;
+        case M_SEI: P |= FLAG_I; break;
+
+        case M_CMP: compare(A, bus_read(ea)); break;
+        case M_CPX: compare(X, bus_read(ea)); break;
+        case M_CPY: compare(Y, bus_read(ea)); break;
+
+        case M_DEC: v = bus_read(ea) - 1; set_zn(v); bus_write(ea, v); break;
+        case M_INC: v = bus_read(ea) + 1; set_zn(v); bus_write(ea, v); break;
+        case M_DEX: set_zn(--X); break;
+        case M_DEY: set_zn(--Y); break;
+        case M_INX: set_zn(++X); break;
+        case M_INY: set_zn(++Y); break;
+
+        case M_JMP: PC = ea; break;
+        case M_JSR:
+            PC--;
+            push(PC >> 8);
+            push(PC & 0xFF);
+            PC = ea;
+            break;
+        case M_RTS:
+            if (audio_active && S == audio_sp) audio_end(cpu_cycles + o->cycles);
+            PC = pull();
+            PC |= pull() << 8;
+            PC++;
+            break;
+        case M_RTI:
+            if (in_nmi && S == nmi_sp) {
+                nmi_cycles = (int64_t)(cpu_cycles + o->cycles - nmi_start);
+                in_nmi = 0;
+            }
+            if (in_irq && S == irq_sp) in_irq = 0;
+            P = (pull() & ~FLAG_B) | FLAG_U;
+            PC = pull();
+            PC |= pull() << 8;
+            break;
+
+        case M_LDA: A = bus_read(ea); set_zn(A); break;
+        case M_LDX: X = bus_read(ea); set_zn(X); break;
+        case M_LDY: Y = bus_read(ea); set_zn(Y); break;
+        case M_STA: bus_write(ea, A); break;
+        case M_STX: bus_write(ea, X); break;
+        case M_STY: bus_write(ea, Y); break;
+
+        case M_NOP: break;
+        case M_PHA: push(A); break;
+        case M_PHP: push(P | FLAG_B | FLAG_U); break;
+        case M_PLA: A = pull(); set_zn(A); break;
+        case M_PLP: P = (pull() & ~FLAG_B) | FLAG_U; break;
+
+        case M_TAX: X = A; set_zn(X); break;
+        case M_TAY: Y = A; set_zn(Y); break;
+        case M_TSX: X = S; set_zn(X); break;
+        case M_TXA: A = X; set_zn(A); break;
+        case M_TXS: S = X; break;
+        case M_TYA: A = Y; set_zn(A); break;
+    }
+
+    cpu_cycles += o->cycles + extra;
+    if (audio_interrupted) audio_skipped += cpu_cycles - step_start;
+    ppu_catch_up(cpu_cycles);
+
+    if (nmi_pending) {
+        nmi_pending = 0;
+        interrupt(0xFFFA);
+        if (audio_active && !audio_from_nmi) audio_skipped += 7;
+        in_nmi = 1;
+        nmi_sp = S;
+        nmi_start = cpu_cycles - 7;
+    } else if (irq_line && !(P & FLAG_I)) {
+        interrupt(0xFFFE);
+        if (audio_active && !audio_from_nmi) audio_skipped += 7;
+        in_irq = 1;
+        irq_sp = S;
+    }
+    return 1;
+}
+
+
+//--------------------------------------------------------//
+//                 CARGA E RELATÓRIO                      //
+//--------------------------------------------------------//
+
+static void load_rom(const char* path) {
+    uint8_t header[16];
+    FILE* f = fopen(path, "rb");
+
+    if (!f || fread(header, 1, 16, f) != 16 || memcmp(header, "NES\x1A", 4)) {
+        fprintf(stderr, "%s: não é uma ROM iNES\n", path);
+        exit(2);
+    }
+    mapper = (header[6] >> 4) | (header[7] & 0xF0);
+    if (mapper != 0 && mapper != 4) {
+        fprintf(stderr, "%s: mapper %d não suportado (só 0 e 4)\n", path, mapper);
+        exit(2);
+    }
+    vertical_mirroring = header[6] & 1;
+    if (header[6] & 4) fseek(f, 512, SEEK_CUR);
+
+    prg_size = header[4] * 0x4000;
+    prg = malloc(prg_size);
+    if (fread(prg, 1, prg_size, f) != prg_size) {
+        fprintf(stderr, "%s: PRG incompleta\n", path);
+        exit(2);
+    }
+    chr_is_ram = header[5] == 0;
+    if (!chr_is_ram && fread(chr, 1, 0x2000, f) != 0x2000) {
+        fprintf(stderr, "%s: CHR incompleta\n", path);
+        exit(2);
+    }
+    fclose(f);
+}
+
+static void print_histogram(const char* title, const uint32_t* hist, int buckets, int width) {
+    int i;
+
+    printf("%s\n", title);
+    for (i = 0; i < buckets; i++) {
+        if (i == buckets - 1) {
+            printf("  %5d-       %8u\n", i * width, hist[i]);
+        } else {
+            printf("  %5d-%-5d  %8u\n", i * width, (i + 1) * width - 1, hist[i]);
+        }
+    }
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "uso: %s [-n quadros] [--log arquivo] [--dump arquivo] "
+            "[--input roteiro | --random semente] [--splits linha,...] [--map mapfile] rom.nes\n", prog);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    const char* rom = NULL;
+    const char* map = NULL;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            frames_wanted = strtoull(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--log") && i + 1 < argc) {
+            log_file = fopen(argv[++i], "w");
+            if (!log_file) {
+                perror(argv[i]);
+                return 2;
+            }
+        } else if (!strcmp(argv[i], "--dump") && i + 1 < argc) {
+            dump_file = fopen(argv[++i], "wb");
+            if (!dump_file) {
+                perror(argv[i]);
+                return 2;
+            }
+        } else if (!strcmp(argv[i], "--input") && i + 1 < argc) {
+            parse_inputs(argv[++i]);
+        } else if (!strcmp(argv[i], "--random") && i + 1 < argc) {
+            random_input = 1;
+            random_seed = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--splits") && i + 1 < argc) {
+            parse_splits(argv[++i]);
+        } else if (!strcmp(argv[i], "--map") && i + 1 < argc) {
+            map = argv[++i];
+        } else if (argv[i][0] != '-' && !rom) {
+            rom = argv[i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (!rom) usage(argv[0]);
+
+    load_rom(rom);
+    if (map) audio_addr = map_symbol(map, "_famitone_update");
+    S = 0xFD;
+    P = FLAG_I | FLAG_U;
+    PC = bus_read(0xFFFC) | (bus_read(0xFFFD) << 8);
+
+    while (frame <= frames_wanted) {
+        if (!cpu_step()) {
+            fprintf(stderr, "opcode ilegal $%02X em $%04X (quadro %llu)\n",
+                    bus_read(PC), PC, (unsigned long long)frame);
+            return 2;
+        }
+    }
+    if (log_file) fclose(log_file);
+    if (dump_file) fclose(dump_file);
+
+    printf("rom %s, %llu quadros (%llu com a PPU ligada, %llu desligada)\n", rom,
+           (unsigned long long)frames_wanted, (unsigned long long)frames_measured,
+           (unsigned long long)frames_dark);
+    printf("vblank: %d ciclos de CPU\n", VBLANK_CYCLES);
+    if (upload_max >= 0) {
+        printf("upload do NMI: máximo %lld ciclos (quadro %llu), sobra mínima %lld\n",
+               (long long)upload_max, (unsigned long long)upload_max_frame,
+               (long long)(VBLANK_CYCLES - upload_max));
+    }
+    printf("quadros sem upload: %llu\n", (unsigned long long)frames_no_upload);
+    if (nmi_max >= 0) {
+        printf("NMI até o RTI: máximo %lld ciclos (quadro %llu)\n",
+               (long long)nmi_max, (unsigned long long)nmi_max_frame);
+    }
+    printf("escritas fora do vblank: %llu no NMI, %llu fora do NMI\n",
+           (unsigned long long)bad_in_nmi, (unsigned long long)bad_outside_nmi);
+    print_histogram("histograma: ciclos do vblank usados pelo upload do NMI",
+                    upload_hist, UPLOAD_BUCKETS, UPLOAD_BUCKET);
+    print_histogram("histograma: ciclos do NMI até o RTI",
+                    nmi_hist, NMI_BUCKETS, NMI_BUCKET);
+
+    if (audio_addr >= 0) {
+        print_audio("famitone_update no NMI", &audio_nmi);
+        print_audio("famitone_update adiado para depois do split", &audio_deferred);
+        printf("famitone_update: pior caso %lld ciclos (AUDIO_UPDATE_CYCLES)\n",
+               (long long)(audio_nmi.max > audio_deferred.max ? audio_nmi.max : audio_deferred.max));
+    }
+
+    if (split_count >= 0) {
+        printf("splits da IRQ: %llu conferidos, %llu fora da linha pedida\n",
+               (unsigned long long)splits_checked, (unsigned long long)splits_bad);
+    }
+
+    for (i = 0; i < TEST_ROUTINES; i++) {
+        if (tests[i].calls || tests[i].fails) {
+            print_tests();
+            break;
+        }
+    }
+
+    return (bad_in_nmi || bad_outside_nmi || test_failed() || splits_bad) ? 1 : 0;
+}
@@ -0,0 +1,39 @@
+
+#ifndef _PPU_DUMP_H
+#define _PPU_DUMP_H
+
+// Estado da PPU de um quadro, gravado pelo tools/nes_trace.c (--dump) e
+// desenhado pelo tools/ppu_render.c.
+//
+// O arquivo é uma sequência de PpuDump, cada um seguido dos 8K da pattern
+// table quando PPU_DUMP_CHR está ligado (cartucho com CHR-RAM); sem ele,
+// o renderer usa o tileset.chr. Formato do host (as duas ferramentas são
+// compiladas na mesma máquina).
+
+#include <stdint.h>
+
+#define PPU_DUMP_MAGIC    0x46555050    // "PPUF"
+#define PPU_DUMP_LINES    240
+
+// flags
+#define PPU_DUMP_VERTICAL 0x01          // espelhamento vertical
+#define PPU_DUMP_CHR      0x02          // segue a pattern table (8K)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t frame;
+    uint16_t scroll_y;                  // 0-479, do início do quadro
+    uint8_t flags;
+    uint8_t reserved;
+    // Por linha, como a PPU copia no ponto 257 da linha anterior:
+    // scroll horizontal (0-511, com o bit da nametable), PPU_CTRL e PPU_MASK.
+    // O split do sprite zero aparece aqui como uma troca de line_x.
+    uint16_t line_x[PPU_DUMP_LINES];
+    uint8_t line_ctrl[PPU_DUMP_LINES];
+    uint8_t line_mask[PPU_DUMP_LINES];
+    uint8_t nametables[0x800];
+    uint8_t palette[32];
+    uint8_t oam[256];
+} PpuDump;
+
+#endif // ppu_dump.h
@@ -0,0 +1,421 @@
+//--------------------------------------------------------//
+//        Dragon's Leap - renderer da PPU no host         //
+//--------------------------------------------------------//
+//
+// Ferramenta do host: desenha os quadros gravados pelo tools/nes_trace.c
+// (--dump) a partir do estado da PPU de cada quadro: nametables e
+// atributos, OAM, paleta e o scroll de cada linha (o split do sprite zero
+// inclusive). A pattern table vem do próprio dump (CHR-RAM) ou do
+// tileset.chr.
+//
+// Os tiles são decodificados uma vez por pattern table (2 planos -> 1 byte
+// por pixel), 16 pixels por instrução com SSE2 quando disponível; as linhas
+// do fundo também são montadas 8 pixels por vez. Cada quadro vira uma
+// imagem de índices da paleta da PPU (256x240, 6 bits), que é resumida
+// num hash FNV-1a de 64 bits. Comparar hashes com uma lista de referência
+// verifica uma partida inteira em segundos, sem guardar imagens.
+//
+// Compilar:  cc -O2 -o tools/ppu_render tools/ppu_render.c
+// Uso:       tools/ppu_render [--chr tileset.chr] [--hash] [--check referência.txt]
+//                             [--ppm diretório] [--frame N] dump.ppu
+//   --hash   imprime "quadro hash" de cada quadro (a lista de referência)
+//   --check  compara com uma lista gerada por --hash; sai com 1 se algum
+//            hash diferir ou se sobrar quadro de um lado ou do outro
+//   --ppm    grava cada quadro (ou só o --frame N) como diretório/NNNNNN.ppm
+//   --chr    só pode faltar se todos os quadros do dump trazem a CHR-RAM
+//
+// Sem emulação de prioridade entre sprites além da ordem da OAM, sem o
+// limite de 8 sprites por linha e sem o bug dos atributos nas linhas 30-31.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "ppu_dump.h"
+
+#define WIDTH   256
+#define HEIGHT  PPU_DUMP_LINES
+#define TILES   512
+
+// Paleta mestre NTSC (2C02), RGB
+static const uint8_t nes_rgb[64][3] = {
+    { 84, 84, 84}, {  0, 30,116}, {  8, 16,144}, { 48,  0,136}, { 68,  0,100}, { 92,  0, 48}, { 84,  4,  0}, { 60, 24,  0},
+    { 32, 42,  0}, {  8, 58,  0}, {  0, 64,  0}, {  0, 60,  0}, {  0, 50, 60}, {  0,  0,  0}, {  0,  0,  0}, {  0,  0,  0},
+    {152,150,152}, {  8, 76,196}, { 48, 50,236}, { 92, 30,228}, {136, 20,176}, {160, 20,100}, {152, 34, 32}, {120, 60,  0},
+    { 84, 90,  0}, { 40,114,  0}, {  8,124,  0}, {  0,118, 40}, {  0,102,120}, {  0,  0,  0}, {  0,  0,  0}, {  0,  0,  0},
+    {236,238,236}, { 76,154,236}, {120,124,236}, {176, 98,236}, {228, 84,236}, {236, 88,180}, {236,106,100}, {212,136, 32},
+    {160,170,  0}, {116,196,  0}, { 76,208, 32}, { 56,204,108}, { 56,180,204}, { 60, 60, 60}, {  0,  0,  0}, {  0,  0,  0},
+    {236,238,236}, {168,204,236}, {188,188,236}, {212,178,236}, {236,174,236}, {236,174,212}, {236,180,176}, {228,196,144},
+    {204,210,120}, {180,222,120}, {168,226,144}, {152,226,180}, {160,214,228}, {160,162,160}, {  0,  0,  0}, {  0,  0,  0},
+};
+
+// Tiles decodificados: [tile][linha][pixel], valores 0-3; e espelhados na horizontal
+static uint8_t tiles[TILES][8][8];
+static uint8_t tiles_flipped[TILES][8][8];
+
+static uint8_t chr_file[0x2000];
+static uint8_t chr_dump[0x2000];
+static const uint8_t* chr_decoded;      // pattern table que está em tiles[]
+
+static PpuDump dump;
+static uint8_t image[HEIGHT][WIDTH];    // índices da paleta da PPU
+
+
+//--------------------------------------------------------//
+//               DECODIFICAÇÃO DOS TILES                  //
+//--------------------------------------------------------//
+
+#ifdef __SSE2__
+
+// Duas linhas de um tile (16 pixels) por vez: cada byte do plano é
+// replicado nos 8 bytes da linha e testado contra a máscara do bit.
+static void decode_rows(const uint8_t* plane0, const uint8_t* plane1,
+                        uint8_t* out, uint8_t* out_flipped) {
+    const uint64_t spread = 0x0101010101010101ULL;
+    const __m128i bits = _mm_setr_epi8((char)0x80, 0x40, 0x20, 0x10, 8, 4, 2, 1,
+                                       (char)0x80, 0x40, 0x20, 0x10, 8, 4, 2, 1);
+    const __m128i bits_flipped = _mm_setr_epi8(1, 2, 4, 8, 0x10, 0x20, 0x40, (char)0x80,
+                                               1, 2, 4, 8, 0x10, 0x20, 0x40, (char)0x80);
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i two = _mm_set1_epi8(2);
+    __m128i p0 = _mm_set_epi64x((long long)(plane0[1] * spread), (long long)(plane0[0] * spread));
+    __m128i p1 = _mm_set_epi64x((long long)(plane1[1] * spread), (long long)(plane1[0] * spread));
+    __m128i lo, hi;
+
+    lo = _mm_cmpeq_epi8(_mm_and_si128(p0, bits), bits);
+    hi = _mm_cmpeq_epi8(_mm_and_si128(p1, bits), bits);
+    _mm_storeu_si128((__m128i*)out, _mm_or_si128(_mm_and_si128(lo, one), _mm_and_si128(hi, two)));
+
+    lo = _mm_cmpeq_epi8(_mm_and_si128(p0, bits_flipped), bits_flipped);
+    hi = _mm_cmpeq_epi8(_mm_and_si128(p1, bits_flipped), bits_flipped);
+    _mm_storeu_si128((__m128i*)out_flipped, _mm_or_si128(_mm_and_si128(lo, one), _mm_and_si128(hi, two)));
+}
+
+#else
+
+static void decode_rows(const uint8_t* plane0, const uint8_t* plane1,
+                        uint8_t* out, uint8_t* out_flipped) {
+    int r, x;
+
+    for (r = 0; r < 2; r++) {
+        for (x = 0; x < 8; x++) {
+            uint8_t px = ((plane0[r] >> (7 - x)) & 1) | (((plane1[r] >> (7 - x)) & 1) << 1);
+            out[r * 8 + x] = px;
+            out_flipped[r * 8 + 7 - x] = px;
+        }
+    }
+}
+
+#endif
+
+static void decode_chr(const uint8_t* chr) {
+    int t, r;
+
+    if (chr == chr_decoded) return;
+    for (t = 0; t < TILES; t++) {
+        const uint8_t* src = chr + t * 16;
+        for (r = 0; r < 8; r += 2) {
+            decode_rows(src + r, src + 8 + r, tiles[t][r], tiles_flipped[t][r]);
+        }
+    }
+    chr_decoded = chr;
+}
+
+
+//--------------------------------------------------------//
+//                    DESENHO                             //
+//--------------------------------------------------------//
+
+static uint8_t nametable_byte(int nt, int offset) {
+    // nt: 0-3 (bit 0 = horizontal, bit 1 = vertical)
+    int bank = (dump.flags & PPU_DUMP_VERTICAL) ? (nt & 1) : (nt >> 1);
+    return dump.nametables[bank * 0x400 + offset];
+}
+
+// Fundo de uma linha: 33 tiles a partir do scroll, 8 pixels por vez,
+// já com a paleta (0 = cor de fundo universal)
+static void render_bg_line(int line, uint8_t* out) {
+    uint8_t buf[(33 + 1) * 8];
+    int sx = dump.line_x[line];
+    int sy = (dump.scroll_y + line) % 480;
+    int nt_y = sy >= 240 ? 2 : 0;
+    int row = (sy % 240) >> 3;
+    int fine_y = sy & 7;
+    int table = (dump.line_ctrl[line] & 0x10) ? 256 : 0;
+    int c;
+
+    for (c = 0; c < 33; c++) {
+        int x = (sx + c * 8) & 511;
+        int nt = nt_y | (x >> 8);
+        int col = (x & 255) >> 3;
+        uint8_t tile = nametable_byte(nt, row * 32 + col);
+        uint8_t attr = nametable_byte(nt, 0x3C0 + (row >> 2) * 8 + (col >> 2));
+        uint8_t pal = ((attr >> (((row & 2) << 1) | (col & 2))) & 3) << 2;
+        const uint8_t* px = tiles[table + tile][fine_y];
+#ifdef __SSE2__
+        __m128i p = _mm_loadl_epi64((const __m128i*)px);
+        __m128i transparent = _mm_cmpeq_epi8(p, _mm_setzero_si128());
+        p = _mm_andnot_si128(transparent, _mm_or_si128(p, _mm_set1_epi8((char)pal)));
+        _mm_storel_epi64((__m128i*)(buf + c * 8), p);
+#else
+        int i;
+        for (i = 0; i < 8; i++) buf[c * 8 + i] = px[i] ? (px[i] | pal) : 0;
+#endif
+    }
+    memcpy(out, buf + (sx & 7), WIDTH);
+    if (!(dump.line_mask[line] & 0x02)) memset(out, 0, 8);
+}
+
+// Sprites de uma linha, na ordem da OAM (o primeiro opaco vence).
+// Valor 0x10-0x1F = cor do sprite; bit 7 = atrás do fundo.
+static void render_sprite_line(int line, uint8_t* out) {
+    int tall = dump.line_ctrl[line] & 0x20;
+    int height = tall ? 16 : 8;
+    int table = (dump.line_ctrl[line] & 0x08) ? 256 : 0;
+    int i, x;
+
+    memset(out, 0, WIDTH);
+    for (i = 0; i < 64; i++) {
+        const uint8_t* s = dump.oam + i * 4;
+        int r = line - (s[0] + 1);
+        int t;
+        const uint8_t* px;
+
+        if (r < 0 || r >= height) continue;
+        if (s[2] & 0x80) r = height - 1 - r;
+        if (tall) {
+            t = ((s[1] & 1) << 8) | (s[1] & 0xFE) | (r >> 3);
+        } else {
+            t = table | s[1];
+        }
+        px = (s[2] & 0x40) ? tiles_flipped[t][r & 7] : tiles[t][r & 7];
+        for (x = 0; x < 8; x++) {
+            int sx = s[3] + x;
+            if (sx >= WIDTH) break;
+            if (px[x] && !out[sx]) {
+                out[sx] = 0x10 | ((s[2] & 3) << 2) | px[x] | ((s[2] & 0x20) << 2);
+            }
+        }
+    }
+    if (!(dump.line_mask[line] & 0x04)) memset(out, 0, 8);
+}
+
+static void render_frame(void) {
+    uint8_t bg[WIDTH], spr[WIDTH];
+    int line, x;
+
+    for (line = 0; line < HEIGHT; line++) {
+        uint8_t mask = dump.line_mask[line];
+        uint8_t* out = image[line];
+
+        if (mask & 0x08) render_bg_line(line, bg);
+        else memset(bg, 0, WIDTH);
+        if (mask & 0x10) render_sprite_line(line, spr);
+        else memset(spr, 0, WIDTH);
+
+        for (x = 0; x < WIDTH; x++) {
+            uint8_t c = bg[x];
+            if (spr[x] && (!(spr[x] & 0x80) || !c)) c = spr[x] & 0x1F;
+            out[x] = dump.palette[c] & ((mask & 0x01) ? 0x30 : 0x3F);
+        }
+    }
+}
+
+static uint64_t image_hash(void) {
+    const uint8_t* p = &image[0][0];
+    uint64_t h = 0xCBF29CE484222325ULL;
+    int i;
+
+    for (i = 0; i < WIDTH * HEIGHT; i++) {
+        h = (h ^ p[i]) * 0x100000001B3ULL;
+    }
+    return h;
+}
+
+static int write_ppm(const char* dir, uint32_t frame) {
+    static uint8_t rgb[HEIGHT][WIDTH][3];
+    char path[1024];
+    FILE* f;
+    int y, x;
+
+    for (y = 0; y < HEIGHT; y++) {
+        for (x = 0; x < WIDTH; x++) {
+            memcpy(rgb[y][x], nes_rgb[image[y][x] & 0x3F], 3);
+        }
+    }
+    snprintf(path, sizeof(path), "%s/%06u.ppm", dir, frame);
+    f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        return 0;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", WIDTH, HEIGHT);
+    fwrite(rgb, sizeof(rgb), 1, f);
+    fclose(f);
+    return 1;
+}
+
+
+//--------------------------------------------------------//
+//                 LISTA DE REFERÊNCIA                    //
+//--------------------------------------------------------//
+
+typedef struct {
+    uint32_t frame;
+    uint64_t hash;
+} Golden;
+
+static Golden* golden;
+static size_t ngolden;
+
+static void load_golden(const char* path) {
+    FILE* f = fopen(path, "r");
+    size_t cap = 0;
+    unsigned long frame;
+    unsigned long long hash;
+
+    if (!f) {
+        perror(path);
+        exit(2);
+    }
+    while (fscanf(f, "%lu %llx", &frame, &hash) == 2) {
+        if (ngolden == cap) {
+            cap = cap ? cap * 2 : 4096;
+            golden = realloc(golden, cap * sizeof(*golden));
+        }
+        golden[ngolden].frame = (uint32_t)frame;
+        golden[ngolden].hash = hash;
+        ngolden++;
+    }
+    fclose(f);
+}
+
+static const Golden* find_golden(uint32_t frame) {
+    size_t lo = 0, hi = ngolden;
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (golden[mid].frame < frame) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < ngolden && golden[lo].frame == frame ? &golden[lo] : NULL;
+}
+
+
+//--------------------------------------------------------//
+//                       MAIN                             //
+//--------------------------------------------------------//
+
+static void usage(const char* prog) {
+    fprintf(stderr, "uso: %s [--chr tileset.chr] [--hash] [--check referência.txt] "
+                    "[--ppm diretório] [--frame N] dump.ppu\n", prog);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    const char* chr_path = "tileset.chr";
+    const char* dump_path = NULL;
+    const char* ppm_dir = NULL;
+    const char* check_path = NULL;
+    long only_frame = -1;
+    int print_hash = 0;
+    unsigned long frames = 0, mismatches = 0, missing = 0, unused = 0;
+    int chr_errno = 0;
+    FILE* f;
+    clock_t start;
+    double seconds;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--chr") && i + 1 < argc) chr_path = argv[++i];
+        else if (!strcmp(argv[i], "--ppm") && i + 1 < argc) ppm_dir = argv[++i];
+        else if (!strcmp(argv[i], "--check") && i + 1 < argc) check_path = argv[++i];
+        else if (!strcmp(argv[i], "--frame") && i + 1 < argc) only_frame = strtol(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--hash")) print_hash = 1;
+        else if (argv[i][0] != '-' && !dump_path) dump_path = argv[i];
+        else usage(argv[0]);
+    }
+    if (!dump_path) usage(argv[0]);
+
+    f = fopen(chr_path, "rb");
+    if (f) {
+        if (fread(chr_file, 1, sizeof(chr_file), f) != sizeof(chr_file)) {
+            fprintf(stderr, "%s: menor que 8K\n", chr_path);
+            return 2;
+        }
+        fclose(f);
+    } else {
+        chr_errno = errno;      // só é erro se algum quadro não trouxer a CHR-RAM
+    }
+    if (check_path) load_golden(check_path);
+
+    f = fopen(dump_path, "rb");
+    if (!f) {
+        perror(dump_path);
+        return 2;
+    }
+
+    start = clock();
+    while (fread(&dump, sizeof(dump), 1, f) == 1) {
+        uint64_t hash;
+
+        if (dump.magic != PPU_DUMP_MAGIC) {
+            fprintf(stderr, "%s: registro inválido depois do quadro %lu\n", dump_path, frames);
+            return 2;
+        }
+        if (dump.flags & PPU_DUMP_CHR) {
+            if (fread(chr_dump, sizeof(chr_dump), 1, f) != 1) break;
+            chr_decoded = NULL;     // a CHR-RAM pode ter mudado
+            decode_chr(chr_dump);
+        } else {
+            if (chr_errno) {
+                errno = chr_errno;
+                perror(chr_path);
+                return 2;
+            }
+            decode_chr(chr_file);
+        }
+        if (only_frame >= 0 && dump.frame != (uint32_t)only_frame) continue;
+
+        render_frame();
+        hash = image_hash();
+        frames++;
+
+        if (print_hash) printf("%u %016llx\n", dump.frame, (unsigned long long)hash);
+        if (ppm_dir && !write_ppm(ppm_dir, dump.frame)) return 2;
+        if (check_path) {
+            const Golden* g = find_golden(dump.frame);
+            if (!g) {
+                missing++;
+            } else if (g->hash != hash) {
+                if (mismatches++ < 20) {
+                    fprintf(stderr, "quadro %u: hash %016llx, referência %016llx\n",
+                            dump.frame, (unsigned long long)hash, (unsigned long long)g->hash);
+                }
+            }
+        }
+    }
+    fclose(f);
+
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    fprintf(stderr, "%lu quadros em %.2f s (%.0f quadros/s)\n",
+            frames, seconds, seconds > 0 ? frames / seconds : 0.0);
+    if (check_path) {
+        // Quadros da referência que o dump não tem (dump truncado); com
+        // --frame só um quadro é desenhado
+        if (only_frame < 0 && ngolden > frames - missing) {
+            unused = ngolden - (frames - missing);
+        }
+        fprintf(stderr, "referência: %lu diferentes, %lu sem referência, %lu fora do dump\n",
+                mismatches, missing, unused);
+        return mismatches || missing || unused ? 1 : 0;
+    }
+    return 0;
+}
@@ -0,0 +1,716 @@
+//--------------------------------------------------------//
+//        Dragon's Leap - verificador de alcançabilidade  //
+//--------------------------------------------------------//
+//
+// Ferramenta do host (não roda no NES). Para cada semente de fase,
+// gera a sequência de gaps de level.h e faz uma busca em largura sobre
+// os estados (y_pos_subpixel, y_vel, pulou no quadro anterior) quadro a
+// quadro, com a física exata de physics.h. Estados repetidos no mesmo
+// quadro são descartados por um conjunto de visitados com hash.
+//
+// Responde se a fase é passável e, com --seed, em quais quadros apertar A.
+// Faixas de sementes são divididas entre todas as CPUs; nelas a busca anda
+// de torre em torre e memoriza o resultado de cada trecho (ver solve_memo).
+//
+// Compilar:  cc -O2 -pthread -o tools/reach_solver tools/reach_solver.c
+// Uso:       tools/reach_solver [-t torres] [-j threads] [primeira última]
+//            tools/reach_solver [-t torres] --seed S
+//
+// Sai com código 1 se alguma fase da faixa for impossível.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../physics.h"
+#include "../level.h"
+
+#define DEFAULT_TOWERS  32
+#define MAX_TOWERS      1024
+#define NO_PARENT       0xFFFFFFFFu
+#define CHUNK_SEEDS     64
+
+// Mesmos tamanhos dos campos de Dragon no cc65
+typedef struct {
+    uint8_t y_pos;
+    int16_t y_vel;
+    int16_t y_pos_subpixel;
+} DragonState;
+
+// Estado compactado em 21 bits:
+//   bits 0-11  y_pos_subpixel (0..4095)
+//   bits 12-19 y_vel - JUMP_SPEED (0..MAX_GRAVITY - JUMP_SPEED)
+//   bit  20    pulou neste quadro (o botão precisa ser solto antes do próximo pulo)
+#define KEY_BITS  21
+#define KEY_JUMP  (1u << 20)
+
+static uint32_t pack(const DragonState* d, int jumped) {
+    return (uint32_t)d->y_pos_subpixel
+         | ((uint32_t)(d->y_vel - JUMP_SPEED) << 12)
+         | (jumped ? KEY_JUMP : 0);
+}
+
+static void unpack(uint32_t key, DragonState* d) {
+    d->y_pos_subpixel = key & 0xFFF;
+    d->y_vel = (int16_t)(((key >> 12) & 0xFF) + JUMP_SPEED);
+    d->y_pos = (uint8_t)(d->y_pos_subpixel >> SUBPIXEL_SHIFT);
+}
+
+
+//--------------------------------------------------------//
+//              CONJUNTO DE VISITADOS                     //
+//--------------------------------------------------------//
+
+// Endereçamento aberto, uma palavra de 32 bits por posição:
+// chave nos 21 bits altos e geração nos 11 baixos. Trocar de geração
+// esvazia a tabela sem apagá-la; ela só é zerada a cada 2047 quadros.
+#define GEN_BITS 11
+#define GEN_MASK ((1u << GEN_BITS) - 1)
+
+typedef struct {
+    uint32_t* slots;
+    uint32_t mask;
+    uint32_t gen;
+    uint32_t count;
+} VisitedSet;
+
+static void visited_init(VisitedSet* v, uint32_t size) {
+    v->slots = calloc(size, sizeof(uint32_t));
+    v->mask = size - 1;
+    v->gen = 0;
+    v->count = 0;
+}
+
+static void visited_next_gen(VisitedSet* v) {
+    if (++v->gen > GEN_MASK) {
+        memset(v->slots, 0, (v->mask + 1) * sizeof(uint32_t));
+        v->gen = 1;
+    }
+    v->count = 0;
+}
+
+static void visited_grow(VisitedSet* v);
+
+// Retorna 1 se a chave é nova neste quadro
+static int visited_insert(VisitedSet* v, uint32_t key) {
+    uint32_t entry = (key << GEN_BITS) | v->gen;
+    uint32_t i = (key * 0x9E3779B1u) >> 7 & v->mask;
+
+    for (;;) {
+        uint32_t s = v->slots[i];
+        if ((s & GEN_MASK) != v->gen) {
+            v->slots[i] = entry;
+            if (++v->count * 2 > v->mask) {
+                visited_grow(v);
+            }
+            return 1;
+        }
+        if (s == entry) {
+            return 0;
+        }
+        i = (i + 1) & v->mask;
+    }
+}
+
+static void visited_grow(VisitedSet* v) {
+    uint32_t* old = v->slots;
+    uint32_t old_size = v->mask + 1;
+    uint32_t gen = v->gen;
+    uint32_t i;
+
+    visited_init(v, old_size * 2);
+    v->gen = gen;
+    for (i = 0; i < old_size; i++) {
+        if ((old[i] & GEN_MASK) == gen) {
+            visited_insert(v, old[i] >> GEN_BITS);
+        }
+    }
+    free(old);
+}
+
+
+//--------------------------------------------------------//
+//                  QUADROS E TRECHOS                     //
+//--------------------------------------------------------//
+
+// Com o espaçamento atual nunca há duas torres sobre o dragão ao mesmo
+// tempo, então cada quadro tem no máximo um gap a respeitar
+#if TOWER_SPACING_PX < TOWER_WIDTH_PX + DRAGON_SIZE
+#error "reach_solver: torres próximas demais, um quadro pode ter duas torres"
+#endif
+
+// Tabelas que só dependem do número de torres, iguais para toda semente
+static int16_t* frame_tower;    // torre que cobre o dragão em cada quadro (-1 = nenhuma)
+static uint32_t goal_frame;     // primeiro quadro com a última torre para trás
+static uint32_t* seg_start;     // primeiro quadro do trecho de cada torre
+static uint16_t* seg_shape;     // trechos com o mesmo formato têm o mesmo número
+
+// Posição em pixels de scroll (sem dar a volta) depois do quadro "frame"
+static uint32_t scroll_at(uint32_t frame) {
+    return (frame * SCROLL_SPEED) >> SUBPIXEL_SHIFT;
+}
+
+// O trecho da torre k vai do primeiro quadro em que ela cobre o dragão
+// até o quadro anterior ao da torre k + 1 (o trecho 0 começa no quadro 1).
+// Dentro de um trecho só o gap da torre k importa.
+static void build_schedule(int ntowers) {
+    uint32_t goal, f, shape_len[MAX_TOWERS], shape_off[MAX_TOWERS], shape_ov[MAX_TOWERS];
+    uint16_t nshapes = 0;
+    int k;
+
+    // A última torre fica para trás quando sua borda direita passa da
+    // caixa de colisão do dragão
+    goal = TOWER_FIRST_X + (uint32_t)(ntowers - 1) * TOWER_SPACING_PX
+         + TOWER_WIDTH_PX - (DRAGON_X_POS + DRAGON_HIT_INSET);
+    for (goal_frame = 1; scroll_at(goal_frame) < goal; goal_frame++);
+
+    frame_tower = malloc((goal_frame + 1) * sizeof(int16_t));
+    seg_start = malloc((ntowers + 1) * sizeof(uint32_t));
+    seg_shape = malloc(ntowers * sizeof(uint16_t));
+
+    seg_start[0] = 1;
+    for (k = 1; k <= ntowers; k++) seg_start[k] = goal_frame;
+    for (f = 1; f <= goal_frame; f++) {
+        uint32_t scroll = scroll_at(f);
+        frame_tower[f] = -1;
+        for (k = 0; k < ntowers; k++) {
+            int32_t tx = (int32_t)(TOWER_FIRST_X + (uint32_t)k * TOWER_SPACING_PX) - (int32_t)scroll;
+            if (TOWER_OVERLAPS_DRAGON(tx)) {
+                frame_tower[f] = k;
+                if (k && seg_start[k] == goal_frame) seg_start[k] = f;
+                break;
+            }
+        }
+    }
+
+    for (k = 0; k < ntowers; k++) {
+        uint32_t len = seg_start[k + 1] - seg_start[k];
+        uint32_t off = 0, ov = 0;
+        uint16_t s;
+
+        while (off < len && frame_tower[seg_start[k] + off] != k) off++;
+        while (off + ov < len && frame_tower[seg_start[k] + off + ov] == k) ov++;
+        for (s = 0; s < nshapes; s++) {
+            if (shape_len[s] == len && shape_off[s] == off && shape_ov[s] == ov) break;
+        }
+        if (s == nshapes) {
+            shape_len[s] = len;
+            shape_off[s] = off;
+            shape_ov[s] = ov;
+            nshapes++;
+        }
+        seg_shape[k] = s;
+    }
+}
+
+
+//--------------------------------------------------------//
+//                     BUSCA                              //
+//--------------------------------------------------------//
+
+typedef struct {
+    uint32_t key;
+    uint32_t parent;        // índice do nó no quadro anterior
+} Node;
+
+// Conjunto de estados na entrada de um trecho, com as chaves ordenadas
+typedef struct {
+    uint64_t hash;
+    uint32_t count;
+    uint32_t* keys;
+} StateSet;
+
+// Memo de trechos: (conjunto de entrada, gap, formato) -> conjunto de saída
+typedef struct {
+    uint64_t tag;
+    int32_t result;         // número do conjunto de saída, ou MEMO_DEAD_*
+} MemoEntry;
+
+#define MEMO_EMPTY       0xFFFFFFFFFFFFFFFFull
+#define MEMO_DEAD_GROUND (-1)
+#define MEMO_DEAD_TOWER  (-2)
+#define MEMO_MAX_KEYS    (1u << 25)     // ~128 MB de chaves por thread
+
+typedef struct {
+    VisitedSet visited;
+    Node* nodes;            // todos os quadros, em sequência
+    uint32_t nodes_cap;
+    uint8_t gaps[MAX_TOWERS];
+
+    StateSet* sets;
+    uint32_t nsets, sets_cap;
+    int32_t* set_index;     // hash -> número do conjunto (-1 = vazio)
+    uint32_t set_index_mask;
+    MemoEntry* memo;
+    uint32_t memo_mask, memo_count;
+    uint32_t memo_keys;     // chaves guardadas em todos os conjuntos
+    uint64_t hits, misses;
+} Solver;
+
+typedef struct {
+    int passable;
+    uint32_t frames;        // quadros simulados (ou quadro da derrota)
+    int tower;              // torre onde todos os caminhos morrem (-1 = chão)
+    uint32_t last_node;     // nó final, para reconstruir as entradas
+} Result;
+
+static void memo_clear(Solver* sv) {
+    uint32_t i;
+
+    for (i = 0; i < sv->nsets; i++) free(sv->sets[i].keys);
+    sv->nsets = 0;
+    sv->memo_keys = 0;
+    sv->memo_count = 0;
+    memset(sv->set_index, 0xFF, (sv->set_index_mask + 1) * sizeof(int32_t));
+    memset(sv->memo, 0xFF, (sv->memo_mask + 1) * sizeof(MemoEntry));
+}
+
+static void solver_init(Solver* sv) {
+    memset(sv, 0, sizeof(*sv));
+    visited_init(&sv->visited, 1 << 12);
+    sv->nodes_cap = 1 << 16;
+    sv->nodes = malloc(sv->nodes_cap * sizeof(Node));
+    sv->sets_cap = 1 << 10;
+    sv->sets = malloc(sv->sets_cap * sizeof(StateSet));
+    sv->set_index_mask = (1 << 12) - 1;
+    sv->set_index = malloc((sv->set_index_mask + 1) * sizeof(int32_t));
+    sv->memo_mask = (1 << 14) - 1;
+    sv->memo = malloc((sv->memo_mask + 1) * sizeof(MemoEntry));
+    memo_clear(sv);
+}
+
+static void solver_free(Solver* sv) {
+    memo_clear(sv);
+    free(sv->visited.slots);
+    free(sv->nodes);
+    free(sv->sets);
+    free(sv->set_index);
+    free(sv->memo);
+}
+
+static void push_node(Solver* sv, uint32_t* n, uint32_t key, uint32_t parent) {
+    if (*n == sv->nodes_cap) {
+        sv->nodes_cap *= 2;
+        sv->nodes = realloc(sv->nodes, sv->nodes_cap * sizeof(Node));
+    }
+    sv->nodes[*n].key = key;
+    sv->nodes[*n].parent = parent;
+    (*n)++;
+}
+
+static void level_gaps(Solver* sv, uint16_t seed, int ntowers) {
+    uint16_t s = seed;
+    int k;
+
+    for (k = 0; k < ntowers; k++) {
+        LEVEL_NEXT_SEED(s);
+        sv->gaps[k] = LEVEL_GAP(s);
+    }
+}
+
+// Expande os nós [begin, end) por um quadro e devolve o fim da nova camada
+static uint32_t step_frame(Solver* sv, uint32_t begin, uint32_t end, uint32_t frame) {
+    int tower = frame_tower[frame];
+    int gap = tower >= 0 ? sv->gaps[tower] : 0;
+    uint32_t n = end, i;
+
+    visited_next_gen(&sv->visited);
+    for (i = begin; i < end; i++) {
+        uint32_t key = sv->nodes[i].key;
+        int jump;
+
+        for (jump = 0; jump < 2; jump++) {
+            DragonState next;
+
+            // pad_trigger(): apertar em dois quadros seguidos não pula de novo
+            if (jump && (key & KEY_JUMP)) continue;
+
+            unpack(key, &next);
+            DRAGON_PHYSICS_STEP(next, jump);
+
+            if (next.y_pos >= DRAGON_MAX_Y) continue;
+            if (tower >= 0 && !DRAGON_IN_GAP(next.y_pos, gap)) continue;
+
+            if (visited_insert(&sv->visited, pack(&next, jump))) {
+                push_node(sv, &n, pack(&next, jump), i);
+            }
+        }
+    }
+    return n;
+}
+
+static uint32_t initial_key(void) {
+    DragonState d;
+
+    // Estado inicial de set_game_state(STATE_PLAY)
+    d.y_pos = DRAGON_INIT_Y_POS;
+    d.y_pos_subpixel = DRAGON_INIT_Y_POS << SUBPIXEL_SHIFT;
+    d.y_vel = 0;
+    return pack(&d, 0);
+}
+
+// Busca completa, guardando os pais para reconstruir as entradas
+static Result solve(Solver* sv, uint16_t seed, int ntowers) {
+    Result r;
+    uint32_t begin, end, n, frame;
+
+    level_gaps(sv, seed, ntowers);
+
+    n = 0;
+    push_node(sv, &n, initial_key(), NO_PARENT);
+    begin = 0;
+    end = n;
+
+    for (frame = 1; frame < goal_frame; frame++) {
+        n = step_frame(sv, begin, end, frame);
+        if (n == end) {
+            r.passable = 0;
+            r.frames = frame;
+            r.tower = frame_tower[frame];
+            r.last_node = NO_PARENT;
+            return r;
+        }
+        begin = end;
+        end = n;
+    }
+
+    r.passable = 1;
+    r.frames = goal_frame - 1;
+    r.tower = 0;
+    r.last_node = begin;
+    return r;
+}
+
+
+//--------------------------------------------------------//
+//                  MEMO DE TRECHOS                       //
+//--------------------------------------------------------//
+
+// O conjunto de estados que sai do trecho de uma torre só depende do
+// conjunto que entrou, do gap e do formato do trecho. Como o teto e os
+// pulos repetidos fazem esses conjuntos convergirem, poucas combinações
+// aparecem em milhares de sementes, e a maioria dos trechos vira uma
+// consulta à tabela.
+
+static int cmp_key(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return h;
+}
+
+static void set_index_grow(Solver* sv) {
+    uint32_t i;
+
+    free(sv->set_index);
+    sv->set_index_mask = sv->set_index_mask * 2 + 1;
+    sv->set_index = malloc((sv->set_index_mask + 1) * sizeof(int32_t));
+    memset(sv->set_index, 0xFF, (sv->set_index_mask + 1) * sizeof(int32_t));
+    for (i = 0; i < sv->nsets; i++) {
+        uint32_t j = (uint32_t)sv->sets[i].hash & sv->set_index_mask;
+        while (sv->set_index[j] >= 0) j = (j + 1) & sv->set_index_mask;
+        sv->set_index[j] = (int32_t)i;
+    }
+}
+
+// Número do conjunto com as chaves "keys" (ordena e copia se for novo)
+static int32_t intern_set(Solver* sv, uint32_t* keys, uint32_t count) {
+    uint64_t h = count;
+    uint32_t i, j;
+
+    qsort(keys, count, sizeof(uint32_t), cmp_key);
+    for (i = 0; i < count; i++) h = mix64(h + keys[i]);
+
+    j = (uint32_t)h & sv->set_index_mask;
+    for (; sv->set_index[j] >= 0; j = (j + 1) & sv->set_index_mask) {
+        StateSet* s = &sv->sets[sv->set_index[j]];
+        if (s->hash == h && s->count == count && !memcmp(s->keys, keys, count * sizeof(uint32_t))) {
+            return sv->set_index[j];
+        }
+    }
+
+    if (sv->nsets == sv->sets_cap) {
+        sv->sets_cap *= 2;
+        sv->sets = realloc(sv->sets, sv->sets_cap * sizeof(StateSet));
+    }
+    sv->sets[sv->nsets].hash = h;
+    sv->sets[sv->nsets].count = count;
+    sv->sets[sv->nsets].keys = malloc(count * sizeof(uint32_t));
+    memcpy(sv->sets[sv->nsets].keys, keys, count * sizeof(uint32_t));
+    sv->memo_keys += count;
+    sv->set_index[j] = (int32_t)sv->nsets;
+    if (++sv->nsets * 2 > sv->set_index_mask) set_index_grow(sv);
+    return (int32_t)sv->nsets - 1;
+}
+
+static MemoEntry* memo_slot(Solver* sv, uint64_t tag) {
+    uint32_t j = (uint32_t)mix64(tag) & sv->memo_mask;
+
+    while (sv->memo[j].tag != MEMO_EMPTY && sv->memo[j].tag != tag) {
+        j = (j + 1) & sv->memo_mask;
+    }
+    return &sv->memo[j];
+}
+
+static void memo_grow(Solver* sv) {
+    MemoEntry* old = sv->memo;
+    uint32_t old_size = sv->memo_mask + 1, i;
+
+    sv->memo_mask = old_size * 2 - 1;
+    sv->memo = malloc(old_size * 2 * sizeof(MemoEntry));
+    memset(sv->memo, 0xFF, old_size * 2 * sizeof(MemoEntry));
+    for (i = 0; i < old_size; i++) {
+        if (old[i].tag != MEMO_EMPTY) *memo_slot(sv, old[i].tag) = old[i];
+    }
+    free(old);
+}
+
+// Simula o trecho da torre k a partir do conjunto "set"
+static int32_t run_segment(Solver* sv, int32_t set, int k) {
+    StateSet* in = &sv->sets[set];
+    uint32_t begin = 0, end = 0, n, i, frame;
+
+    for (i = 0; i < in->count; i++) push_node(sv, &end, in->keys[i], NO_PARENT);
+
+    for (frame = seg_start[k]; frame < seg_start[k + 1]; frame++) {
+        n = step_frame(sv, begin, end, frame);
+        if (n == end) {
+            return frame_tower[frame] >= 0 ? MEMO_DEAD_TOWER : MEMO_DEAD_GROUND;
+        }
+        begin = end;
+        end = n;
+    }
+
+    // Só as chaves da última camada entram no conjunto de saída
+    {
+        uint32_t* keys = malloc((end - begin) * sizeof(uint32_t));
+        int32_t id;
+
+        for (i = begin; i < end; i++) keys[i - begin] = sv->nodes[i].key;
+        id = intern_set(sv, keys, end - begin);
+        free(keys);
+        return id;
+    }
+}
+
+// Mesma resposta de solve(), trecho por trecho, sem as entradas
+static Result solve_memo(Solver* sv, uint16_t seed, int ntowers) {
+    Result r;
+    uint32_t key = initial_key();
+    int32_t set;
+    int k;
+
+    if (sv->memo_keys > MEMO_MAX_KEYS) memo_clear(sv);
+
+    level_gaps(sv, seed, ntowers);
+    set = intern_set(sv, &key, 1);
+
+    r.passable = 0;
+    r.frames = 0;
+    r.last_node = NO_PARENT;
+    for (k = 0; k < ntowers; k++) {
+        uint64_t tag = (uint64_t)(uint32_t)set | ((uint64_t)sv->gaps[k] << 32)
+                     | ((uint64_t)seg_shape[k] << 40);
+        MemoEntry* e = memo_slot(sv, tag);
+        int32_t next;
+
+        if (e->tag == tag) {
+            next = e->result;
+            sv->hits++;
+        } else {
+            next = run_segment(sv, set, k);
+            sv->misses++;
+            e = memo_slot(sv, tag);     // intern_set pode ter crescido tabelas
+            e->tag = tag;
+            e->result = next;
+            if (++sv->memo_count * 2 > sv->memo_mask) memo_grow(sv);
+        }
+
+        if (next < 0) {
+            r.tower = next == MEMO_DEAD_TOWER ? k : -1;
+            return r;
+        }
+        set = next;
+    }
+
+    r.passable = 1;
+    r.frames = goal_frame - 1;
+    r.tower = 0;
+    return r;
+}
+
+
+//--------------------------------------------------------//
+//                  FAIXAS EM PARALELO                    //
+//--------------------------------------------------------//
+
+typedef struct {
+    uint32_t first, last;
+    int ntowers;
+    uint32_t next;              // próxima semente a distribuir (atômico)
+    uint16_t* failed;           // por semente: 0 = passável, 1 = chão, 2 + torre
+    uint64_t hits, misses;      // trechos reaproveitados / simulados (atômicos)
+} Job;
+
+static void* worker(void* arg) {
+    Job* job = arg;
+    Solver sv;
+
+    solver_init(&sv);
+    for (;;) {
+        uint32_t start = __atomic_fetch_add(&job->next, CHUNK_SEEDS, __ATOMIC_RELAXED);
+        uint32_t seed;
+
+        if (start > job->last) break;
+        for (seed = start; seed <= job->last && seed < start + CHUNK_SEEDS; seed++) {
+            Result r = solve_memo(&sv, (uint16_t)seed, job->ntowers);
+            job->failed[seed - job->first] = r.passable ? 0 : (uint16_t)(2 + r.tower);
+        }
+    }
+    __atomic_fetch_add(&job->hits, sv.hits, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&job->misses, sv.misses, __ATOMIC_RELAXED);
+    solver_free(&sv);
+    return NULL;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int run_range(uint32_t first, uint32_t last, int ntowers, int nthreads) {
+    Job job;
+    pthread_t* threads;
+    uint32_t count = last - first + 1;
+    uint32_t bad = 0, i;
+    double t0, dt;
+    int t;
+
+    job.first = first;
+    job.last = last;
+    job.ntowers = ntowers;
+    job.next = first;
+    job.failed = calloc(count, sizeof(uint16_t));
+    job.hits = 0;
+    job.misses = 0;
+    threads = malloc(nthreads * sizeof(pthread_t));
+
+    t0 = now();
+    for (t = 0; t < nthreads; t++) pthread_create(&threads[t], NULL, worker, &job);
+    for (t = 0; t < nthreads; t++) pthread_join(threads[t], NULL);
+    dt = now() - t0;
+
+    for (i = 0; i < count; i++) {
+        if (job.failed[i]) {
+            if (bad < 20) {
+                if (job.failed[i] == 1)
+                    printf("semente %u: impossível (chão)\n", first + i);
+                else
+                    printf("semente %u: impossível (torre %d)\n", first + i, job.failed[i] - 2);
+            }
+            bad++;
+        }
+    }
+    if (bad > 20) printf("... mais %u fases impossíveis\n", bad - 20);
+
+    printf("sementes %u-%u, %d torres: %u fases, %u passáveis, %u impossíveis\n",
+           first, last, ntowers, count, count - bad, bad);
+    printf("%.0f fases/s em %d threads (%.2f s), %.1f%% dos trechos pelo memo\n",
+           count / dt, nthreads, dt, 100.0 * job.hits / (job.hits + job.misses));
+
+    free(job.failed);
+    free(threads);
+    return bad ? 1 : 0;
+}
+
+// Uma semente: gaps, resultado e os quadros em que apertar A
+static int run_seed(uint16_t seed, int ntowers) {
+    Solver sv;
+    Result r;
+    uint32_t* jumps;
+    uint32_t njumps = 0, node, f;
+    int k;
+
+    solver_init(&sv);
+    r = solve(&sv, seed, ntowers);
+
+    printf("semente %u, gaps:", seed);
+    for (k = 0; k < ntowers; k++) printf(" %u", sv.gaps[k]);
+    printf("\n");
+
+    if (!r.passable) {
+        if (r.tower < 0)
+            printf("impossível: nenhum caminho sobrevive ao quadro %u\n", r.frames);
+        else
+            printf("impossível: nenhum caminho passa da torre %d (quadro %u)\n", r.tower, r.frames);
+        solver_free(&sv);
+        return 1;
+    }
+
+    // Volta pelos pais até o estado inicial; o bit de pulo de cada nó
+    // é a entrada daquele quadro
+    jumps = malloc((r.frames + 1) * sizeof(uint32_t));
+    node = r.last_node;
+    for (f = r.frames; node != NO_PARENT && f > 0; f--) {
+        if (sv.nodes[node].key & KEY_JUMP) jumps[njumps++] = f;
+        node = sv.nodes[node].parent;
+    }
+
+    printf("passável em %u quadros, %u pulos (quadros com A):", r.frames, njumps);
+    while (njumps) printf(" %u", jumps[--njumps]);
+    printf("\n");
+
+    free(jumps);
+    solver_free(&sv);
+    return 0;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+        "uso: %s [-t torres] [-j threads] [primeira última]\n"
+        "     %s [-t torres] --seed S\n", prog, prog);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    int ntowers = DEFAULT_TOWERS;
+    int nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    long seed = -1;
+    uint32_t first = 1, last = 0xFFFF;
+    int i, npos = 0;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+            ntowers = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+            nthreads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = strtol(argv[++i], NULL, 0);
+        } else if (argv[i][0] != '-' && npos < 2) {
+            if (npos++ == 0) first = strtoul(argv[i], NULL, 0);
+            else last = strtoul(argv[i], NULL, 0);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (ntowers < 1 || ntowers > MAX_TOWERS || nthreads < 1) usage(argv[0]);
+    build_schedule(ntowers);
+
+    if (seed >= 0) {
+        if (seed < 1 || seed > 0xFFFF) usage(argv[0]);
+        return run_seed((uint16_t)seed, ntowers);
+    }
+    if (npos == 1) last = first;
+    if (first < 1 || last > 0xFFFF || first > last) usage(argv[0]);
+    return run_range(first, last, ntowers, nthreads);
+}
@@ -0,0 +1,1058 @@
+//--------------------------------------------------------//
+//     Dragon's Leap - pior caso de ciclos (análise)      //
+//--------------------------------------------------------//
+//
+// Ferramenta do host: calcula, sem executar a ROM, um limite superior de
+// ciclos de CPU para cada rotina alcançável a partir das raízes dadas
+// (iteração do laço de main, NMI, IRQ) e falha quando o pior caso passa
+// do orçamento do quadro ou do vblank.
+//
+// Lê a ROM já ligada e o mapfile do ld65 (opção -m, seção "Exports list")
+// para os nomes, e um arquivo de anotações (tools/wcet.txt). Para cada
+// rotina, monta os blocos básicos e o grafo de controle a partir da
+// entrada, acha os laços (arestas de volta) e resolve do laço mais interno
+// para o mais externo: cada laço vira um nó de custo
+//     limite x caminho mais longo de uma iteração,
+// e o pior caso da rotina é o caminho mais longo no grafo resultante.
+// Custos por instrução vêm de tools/m6502.h, sempre com +1 quando um
+// índice pode cruzar página; desvios tomados somam +1 (+1 se o destino
+// está em outra página, o que aqui é conhecido). jsr soma o pior caso da
+// rotina chamada; jmp para outra rotina exportada é chamada de cauda.
+//
+// Anotações (uma por linha, # comenta; endereços como rótulo, rótulo+n,
+// $C123 ou @nmi/@reset/@irq, o vetor correspondente):
+//   budget frame|vblank N     orçamentos (padrão 29780 e 2273 ciclos)
+//   frame ROTINA              raiz: uma iteração do laço mais externo
+//   nmi ROTINA                raiz: o NMI inteiro (roubado do quadro)
+//   vblank ROTINA PARADA      raiz: do início do NMI até PARADA (o trabalho da PPU):
+//                             um endereço, ou a rotina chamada ali (resolve/callback)
+//   irq ROTINA N              raiz: N IRQs por quadro
+//   loop ENDEREÇO|ROTINA N    execuções do cabeçalho do laço por entrada
+//                             (com uma ROTINA, vale para todos os laços dela)
+//   total ENDEREÇO|ROTINA N   execuções do cabeçalho por chamada da rotina,
+//                             somando as voltas dos laços de fora (bytes
+//                             copiados no total, não por registro); com uma
+//                             ROTINA, vale para os laços mais internos dela
+//   wait ENDEREÇO|ROTINA      laço de espera (ppu_wait_nmi, sprite zero):
+//                             conta uma volta só, o resto é tempo livre
+//   resolve ENDEREÇO ALVO...  destinos de um jmp indireto em ENDEREÇO, ou de
+//                             um jsr/jmp para ENDEREÇO (p. ex. um jmp na RAM)
+//   callback INSTALADOR ALVO  INSTALADOR começa com sta SLOT+1 / stx SLOT+2
+//                             (nmi_set_callback da neslib): jsr/jmp para o
+//                             jmp em SLOT vão para ALVO
+//   cost ROTINA N             pior caso dado, sem analisar a rotina
+//   trampoline ROTINA         trampolim do #pragma wrapped-call do cc65:
+//                             ptr4 = função, tmp4 = banco de $8000
+//
+// Compilar:  cc -O2 -o tools/wcet tools/wcet.c
+// Uso:       tools/wcet [-v] [--disasm ROTINA] rom.nes mapfile anotações
+//
+// Sai com 1 se algum orçamento estourou e 2 se a análise ficou incompleta
+// (laço sem limite, salto indireto sem destino, recursão).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "m6502.h"
+
+#define FRAME_CYCLES    29780       // 341 x 262 / 3 (NTSC)
+#define VBLANK_CYCLES   2273        // 20 linhas de vblank
+#define MAX_SYMBOLS     8192
+#define MAX_NOTES       1024
+#define MAX_TARGETS     8
+#define MAX_FUNCS       2048
+#define NO_BANK         (-1)
+#define NO_ADDR         (-1)
+
+
+//--------------------------------------------------------//
+//                 ROM E SÍMBOLOS                         //
+//--------------------------------------------------------//
+
+static uint8_t* prg;
+static uint32_t prg_size;
+static int mapper;
+
+typedef struct {
+    char name[64];
+    int addr;
+} Symbol;
+
+static Symbol symbols[MAX_SYMBOLS];
+static int nsymbols;
+
+static int errors;
+static int verbose;
+
+static void error(const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "erro: ");
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    errors++;
+}
+
+// Byte da ROM visto pela CPU; -1 fora da ROM (RAM, registradores).
+// No MMC3, $8000-$9FFF é o banco "bank" (R6), $A000-$BFFF o banco 1 (R7)
+// e $C000-$FFFF os dois últimos bancos.
+static int rom_byte(int bank, int addr) {
+    if (addr < 0x8000 || addr > 0xFFFF) return -1;
+    if (mapper == 0) return prg[(addr - 0x8000) % prg_size];
+    if (addr >= 0xC000) return prg[prg_size - 0x4000 + (addr - 0xC000)];
+    if (addr >= 0xA000) return prg[(0x2000 + (addr - 0xA000)) % prg_size];
+    return prg[((bank < 0 ? 0 : bank) * 0x2000 + (addr - 0x8000)) % prg_size];
+}
+
+static int in_window(int addr) {
+    return mapper == 4 && addr >= 0x8000 && addr < 0xA000;
+}
+
+static const char* symbol_at(int addr) {
+    int i;
+    for (i = 0; i < nsymbols; i++) {
+        if (symbols[i].addr == addr) return symbols[i].name;
+    }
+    return NULL;
+}
+
+static int symbol_addr(const char* name) {
+    int i;
+    for (i = 0; i < nsymbols; i++) {
+        if (!strcmp(symbols[i].name, name)) return symbols[i].addr;
+    }
+    return NO_ADDR;
+}
+
+// Símbolo que contém "addr" (o anterior, a menos de $400); a própria
+// entrada quando não há. Anotações por ROTINA valem também para as
+// entradas internas dela (p. ex. o flush_vram_update chamado pelo NMI).
+static int routine_of(int addr) {
+    int best_addr = -1, i;
+
+    for (i = 0; i < nsymbols; i++) {
+        if (symbols[i].addr <= addr && symbols[i].addr > best_addr && symbols[i].addr >= 0x8000) {
+            best_addr = symbols[i].addr;
+        }
+    }
+    return (best_addr >= 0 && addr - best_addr < 0x400) ? best_addr : addr;
+}
+
+// Nome para os relatórios: o símbolo, ou o símbolo anterior + deslocamento
+static const char* addr_name(int addr) {
+    static char buf[4][96];
+    static int next;
+    char* s = buf[next++ & 3];
+    const char* best = NULL;
+    int best_addr = -1, i;
+
+    for (i = 0; i < nsymbols; i++) {
+        if (symbols[i].addr <= addr && symbols[i].addr > best_addr && symbols[i].addr >= 0x8000) {
+            best = symbols[i].name;
+            best_addr = symbols[i].addr;
+        }
+    }
+    if (best && best_addr == addr) snprintf(s, 96, "%.80s", best);
+    else if (best && addr - best_addr < 0x400) snprintf(s, 96, "%.80s+$%X", best, addr - best_addr);
+    else snprintf(s, 96, "$%04X", addr);
+    return s;
+}
+
+static void load_rom(const char* path) {
+    uint8_t header[16];
+    FILE* f = fopen(path, "rb");
+
+    if (!f || fread(header, 1, 16, f) != 16 || memcmp(header, "NES\x1A", 4)) {
+        fprintf(stderr, "%s: não é uma ROM iNES\n", path);
+        exit(2);
+    }
+    mapper = (header[6] >> 4) | (header[7] & 0xF0);
+    if (mapper != 0 && mapper != 4) {
+        fprintf(stderr, "%s: mapper %d não suportado (só 0 e 4)\n", path, mapper);
+        exit(2);
+    }
+    if (header[6] & 4) fseek(f, 512, SEEK_CUR);
+    prg_size = header[4] * 0x4000;
+    prg = malloc(prg_size);
+    if (fread(prg, 1, prg_size, f) != prg_size) {
+        fprintf(stderr, "%s: PRG incompleta\n", path);
+        exit(2);
+    }
+    fclose(f);
+}
+
+// "Exports list by name:" do mapfile: trios nome, valor, flags por linha
+static void load_map(const char* path) {
+    char line[512];
+    int in_exports = 0;
+    FILE* f = fopen(path, "r");
+
+    if (!f) {
+        perror(path);
+        exit(2);
+    }
+    while (fgets(line, sizeof(line), f)) {
+        char name[64], flags[16];
+        unsigned value;
+        char* p = line;
+        int n;
+
+        if (!strncmp(line, "Exports list", 12)) {
+            in_exports = 1;
+            continue;
+        }
+        if (!in_exports) continue;
+        if (line[0] == '-') continue;
+        if (line[0] == '\n' || line[0] == '\r') {
+            if (nsymbols) in_exports = 0;
+            continue;
+        }
+        while (sscanf(p, "%63s %x %15s%n", name, &value, flags, &n) == 3 && nsymbols < MAX_SYMBOLS) {
+            if (symbol_addr(name) == NO_ADDR) {
+                strcpy(symbols[nsymbols].name, name);
+                symbols[nsymbols].addr = (int)value;
+                nsymbols++;
+            }
+            p += n;
+        }
+    }
+    fclose(f);
+}
+
+
+//--------------------------------------------------------//
+//                    ANOTAÇÕES                           //
+//--------------------------------------------------------//
+
+enum { NOTE_LOOP, NOTE_TOTAL, NOTE_WAIT, NOTE_RESOLVE, NOTE_COST };
+
+typedef struct {
+    int kind;
+    int addr;
+    long value;
+    int ntargets;
+    int targets[MAX_TARGETS];
+} Note;
+
+static Note notes[MAX_NOTES];
+static int nnotes;
+
+static long budget_frame = FRAME_CYCLES;
+static long budget_vblank = VBLANK_CYCLES;
+static int root_frame = NO_ADDR;
+static int root_nmi = NO_ADDR;
+static int root_vblank = NO_ADDR, vblank_stop = NO_ADDR;
+static int root_irq = NO_ADDR;
+static long irq_count;
+static int trampoline = NO_ADDR;
+static int ptr4_addr = NO_ADDR, tmp4_addr = NO_ADDR;
+
+// Rótulo, rótulo+n, $hex, 0xhex ou @nmi/@reset/@irq. Um rótulo que não
+// está no mapfile só é erro quando "required" (raízes); nas anotações de
+// laços e custos é uma rotina que não entrou nesta build.
+static int parse_addr(const char* s, int required) {
+    char name[96];
+    const char* plus;
+    int base;
+
+    if (!strcmp(s, "@nmi")) return rom_byte(NO_BANK, 0xFFFA) | (rom_byte(NO_BANK, 0xFFFB) << 8);
+    if (!strcmp(s, "@reset")) return rom_byte(NO_BANK, 0xFFFC) | (rom_byte(NO_BANK, 0xFFFD) << 8);
+    if (!strcmp(s, "@irq")) return rom_byte(NO_BANK, 0xFFFE) | (rom_byte(NO_BANK, 0xFFFF) << 8);
+    if (s[0] == '$') return (int)strtol(s + 1, NULL, 16);
+    if (!strncmp(s, "0x", 2)) return (int)strtol(s, NULL, 16);
+
+    plus = strchr(s, '+');
+    snprintf(name, sizeof(name), "%.*s", plus ? (int)(plus - s) : (int)strlen(s), s);
+    base = symbol_addr(name);
+    if (base == NO_ADDR) {
+        if (required) error("símbolo %s não está no mapfile", name);
+        else if (verbose) fprintf(stderr, "aviso: %s não está no mapfile, anotação ignorada\n", name);
+        return NO_ADDR;
+    }
+    if (plus) base += (int)strtol(plus + 1 + (plus[1] == '$'), NULL, plus[1] == '$' ? 16 : 0);
+    return base;
+}
+
+// Endereço do jmp que INSTALADOR reescreve: sta SLOT+1 e stx SLOT+2 (zero
+// page ou absoluto) nas primeiras instruções
+static int callback_slot(int installer) {
+    int op = rom_byte(NO_BANK, installer);
+    int lo = rom_byte(NO_BANK, installer + 1);
+
+    if (installer == NO_ADDR) return NO_ADDR;
+    if (op == 0x85 && rom_byte(NO_BANK, installer + 2) == 0x86
+        && rom_byte(NO_BANK, installer + 3) == lo + 1) {
+        return lo - 1;
+    }
+    if (op == 0x8D && rom_byte(NO_BANK, installer + 3) == 0x8E) {
+        int a = lo | (rom_byte(NO_BANK, installer + 2) << 8);
+        int b = rom_byte(NO_BANK, installer + 4) | (rom_byte(NO_BANK, installer + 5) << 8);
+        if (b == a + 1) return a - 1;
+    }
+    error("%s não começa com sta SLOT+1 / stx SLOT+2", addr_name(installer));
+    return NO_ADDR;
+}
+
+static void load_notes(const char* path) {
+    char line[512];
+    FILE* f = fopen(path, "r");
+
+    if (!f) {
+        perror(path);
+        exit(2);
+    }
+    while (fgets(line, sizeof(line), f)) {
+        char* argv[MAX_TARGETS + 2];
+        char* hash = strchr(line, '#');
+        char* tok;
+        int argc = 0;
+
+        if (hash) *hash = 0;
+        for (tok = strtok(line, " \t\r\n"); tok && argc < MAX_TARGETS + 2; tok = strtok(NULL, " \t\r\n")) {
+            argv[argc++] = tok;
+        }
+        if (!argc) continue;
+
+        if (!strcmp(argv[0], "budget") && argc == 3) {
+            if (!strcmp(argv[1], "frame")) budget_frame = atol(argv[2]);
+            else budget_vblank = atol(argv[2]);
+        } else if (!strcmp(argv[0], "frame") && argc == 2) {
+            root_frame = parse_addr(argv[1], 1);
+        } else if (!strcmp(argv[0], "nmi") && argc == 2) {
+            root_nmi = parse_addr(argv[1], 1);
+        } else if (!strcmp(argv[0], "vblank") && argc == 3) {
+            root_vblank = parse_addr(argv[1], 1);
+            vblank_stop = parse_addr(argv[2], 1);
+        } else if (!strcmp(argv[0], "irq") && argc == 3) {
+            root_irq = parse_addr(argv[1], 1);
+            irq_count = atol(argv[2]);
+        } else if (!strcmp(argv[0], "trampoline") && argc == 2) {
+            trampoline = parse_addr(argv[1], 1);
+            ptr4_addr = symbol_addr("ptr4");
+            tmp4_addr = symbol_addr("tmp4");
+            if (ptr4_addr == NO_ADDR || tmp4_addr == NO_ADDR) {
+                error("trampolim %s sem ptr4/tmp4 no mapfile", argv[1]);
+            }
+        } else if (!strcmp(argv[0], "callback") && argc == 3 && nnotes < MAX_NOTES) {
+            Note* n = &notes[nnotes++];
+            n->kind = NOTE_RESOLVE;
+            n->addr = callback_slot(parse_addr(argv[1], 1));
+            n->value = 1;
+            n->ntargets = 1;
+            n->targets[0] = parse_addr(argv[2], 1);
+            if (n->addr == NO_ADDR) nnotes--;
+        } else if (nnotes < MAX_NOTES && (
+                   (!strcmp(argv[0], "loop") && argc == 3) ||
+                   (!strcmp(argv[0], "total") && argc == 3) ||
+                   (!strcmp(argv[0], "wait") && argc == 2) ||
+                   (!strcmp(argv[0], "cost") && argc == 3) ||
+                   (!strcmp(argv[0], "resolve") && argc >= 3))) {
+            Note* n = &notes[nnotes++];
+            int i;
+            n->kind = argv[0][0] == 'l' ? NOTE_LOOP : argv[0][0] == 't' ? NOTE_TOTAL
+                    : argv[0][0] == 'w' ? NOTE_WAIT : argv[0][0] == 'r' ? NOTE_RESOLVE : NOTE_COST;
+            n->addr = parse_addr(argv[1], 0);
+            n->value = (n->kind == NOTE_RESOLVE || n->kind == NOTE_WAIT) ? 1 : atol(argv[2]);
+            n->ntargets = 0;
+            if (n->kind == NOTE_RESOLVE) {
+                for (i = 2; i < argc; i++) n->targets[n->ntargets++] = parse_addr(argv[i], 1);
+            }
+            if (n->addr == NO_ADDR) nnotes--;
+        } else {
+            error("anotação inválida: %s", argv[0]);
+        }
+    }
+    fclose(f);
+}
+
+static const Note* find_note(int kind, int addr) {
+    int i;
+    for (i = 0; i < nnotes; i++) {
+        if (notes[i].kind == kind && notes[i].addr == addr) return &notes[i];
+    }
+    return NULL;
+}
+
+// Um jsr para "target" chega em "stop"? (o próprio endereço, ou um destino
+// dado por resolve/callback)
+static int reaches(int target, int stop) {
+    const Note* n = find_note(NOTE_RESOLVE, target);
+    int i;
+
+    if (target == stop) return 1;
+    for (i = 0; n && i < n->ntargets; i++) {
+        if (n->targets[i] == stop) return 1;
+    }
+    return 0;
+}
+
+
+//--------------------------------------------------------//
+//               ROTINAS E BLOCOS BÁSICOS                 //
+//--------------------------------------------------------//
+
+typedef struct {
+    int addr;
+    uint8_t opcode;
+    int operand;
+    const M6502Op* op;
+} Insn;
+
+typedef struct {
+    int start;              // endereço da primeira instrução
+    int first, count;       // instruções em Function.insns
+    long cost;              // ciclos das instruções, com as chamadas
+    int succ[2];            // blocos seguintes (-1 = nenhum)
+    int edge[2];            // ciclos extras de cada aresta (desvio tomado)
+} Block;
+
+typedef struct {
+    int bank;
+    int entry;
+    int tramp;              // analisada dentro do trampolim (jmp (ptr4) volta a quem chamou)
+    int state;              // 0 = nova, 1 = em análise, 2 = pronta
+    long wcet;
+    int loops;
+} Function;
+
+static Function funcs[MAX_FUNCS];
+static int nfuncs;
+static int tramp_depth;
+
+static long function_wcet(int bank, int entry);
+
+static int decode(int bank, int addr, Insn* in) {
+    int b0 = rom_byte(bank, addr), b1, b2;
+    int len;
+
+    if (b0 < 0) return 0;
+    in->addr = addr;
+    in->opcode = (uint8_t)b0;
+    in->op = &m6502_ops[b0];
+    if (in->op->op == M_ILLEGAL) return 0;
+    len = m6502_mode_bytes[in->op->mode];
+    b1 = len > 1 ? rom_byte(bank, addr + 1) : 0;
+    b2 = len > 2 ? rom_byte(bank, addr + 2) : 0;
+    if (b1 < 0 || b2 < 0) return 0;
+    if (in->op->mode == AM_REL) in->operand = (addr + 2 + (int8_t)b1) & 0xFFFF;
+    else in->operand = len == 3 ? (b1 | (b2 << 8)) : b1;
+    return len;
+}
+
+static int is_branch(const Insn* in) {
+    return in->op->mode == AM_REL;
+}
+
+// jmp absoluto para outra rotina exportada ou para fora da ROM (um jmp
+// montado na RAM): chamada de cauda
+static int is_tail_call(const Insn* in, int entry) {
+    return in->op->op == M_JMP && in->op->mode == AM_ABS && in->operand != entry
+        && (symbol_at(in->operand) != NULL || rom_byte(NO_BANK, in->operand) < 0);
+}
+
+static int ends_block(const Insn* in, int entry) {
+    return is_branch(in) || in->op->op == M_JMP || in->op->op == M_RTS
+        || in->op->op == M_RTI || is_tail_call(in, entry);
+}
+
+// Pior caso de um jsr/jmp para "target" (a chamada em si não incluída)
+static long call_cost(int bank, int target, int at) {
+    const Note* n = find_note(NOTE_RESOLVE, target);
+    long worst = 0;
+    int i;
+
+    if (n) {
+        for (i = 0; i < n->ntargets; i++) {
+            long c = function_wcet(bank, n->targets[i]);
+            if (c > worst) worst = c;
+        }
+        return worst;
+    }
+    if (rom_byte(bank, target) < 0 && !find_note(NOTE_COST, target)) {
+        error("chamada para $%04X fora da ROM sem 'resolve', em %s", target, addr_name(at));
+        return 0;
+    }
+    return function_wcet(in_window(target) ? bank : NO_BANK, target);
+}
+
+// jsr para o trampolim: ptr4, ptr4+1 e tmp4 gravados com constantes
+// (lda/ldx/ldy #imediato e sta/stx/sty) no mesmo bloco
+static long trampoline_call_cost(const Insn* insns, int first, int last) {
+    int reg[3] = { -1, -1, -1 };        // A, X, Y
+    int lo = -1, hi = -1, bank = -1;
+    int i;
+
+    for (i = first; i < last; i++) {
+        const Insn* in = &insns[i];
+        int r = -1, v = -1;
+
+        switch (in->op->op) {
+            case M_LDA: r = 0; break;
+            case M_LDX: r = 1; break;
+            case M_LDY: r = 2; break;
+            case M_STA: v = reg[0]; break;
+            case M_STX: v = reg[1]; break;
+            case M_STY: v = reg[2]; break;
+            case M_TAX: reg[1] = reg[0]; continue;
+            case M_TAY: reg[2] = reg[0]; continue;
+            case M_TXA: reg[0] = reg[1]; continue;
+            case M_TYA: reg[0] = reg[2]; continue;
+            default:    continue;
+        }
+        if (r >= 0) {
+            reg[r] = in->op->mode == AM_IMM ? in->operand : -1;
+        } else if (in->op->mode == AM_ZP || in->op->mode == AM_ABS) {
+            if (in->operand == ptr4_addr) lo = v;
+            else if (in->operand == ptr4_addr + 1) hi = v;
+            else if (in->operand == tmp4_addr) bank = v;
+        }
+    }
+    if (lo < 0 || hi < 0 || bank < 0) {
+        error("chamada pelo trampolim sem ptr4/tmp4 constantes em $%04X", insns[last].addr);
+        return 0;
+    }
+    tramp_depth++;
+    i = (int)function_wcet(NO_BANK, trampoline);
+    tramp_depth--;
+    return i + function_wcet(in_window(lo | (hi << 8)) ? bank : NO_BANK, lo | (hi << 8));
+}
+
+// Custo de uma instrução, com o que ela chama
+static long insn_cost(int bank, int entry, const Insn* insns, int i, int block_first) {
+    const Insn* in = &insns[i];
+    long c = in->op->cycles + in->op->page;
+
+    if (in->op->op == M_JSR) {
+        if (trampoline != NO_ADDR && in->operand == trampoline) {
+            c += trampoline_call_cost(insns, block_first, i);
+        } else {
+            c += call_cost(bank, in->operand, in->addr);
+        }
+    } else if (is_tail_call(in, entry)) {
+        c += call_cost(bank, in->operand, in->addr);
+    } else if (in->op->op == M_JMP && in->op->mode == AM_IND) {
+        const Note* n = find_note(NOTE_RESOLVE, in->addr);
+        if (n) {
+            int t;
+            long worst = 0;
+            for (t = 0; t < n->ntargets; t++) {
+                long w = function_wcet(bank, n->targets[t]);
+                if (w > worst) worst = w;
+            }
+            c += worst;
+        } else if (!(tramp_depth && in->operand == ptr4_addr)) {
+            error("jmp indireto sem 'resolve' em $%04X", in->addr);
+        }
+    }
+    return c;
+}
+
+// Limite de um laço: anotação do cabeçalho ou da rotina. Laços de espera
+// contam uma volta.
+static long loop_bound(int header, int entry) {
+    static int reported[MAX_NOTES];
+    static int nreported;
+    const Note* n;
+    int i;
+
+    if ((n = find_note(NOTE_LOOP, header)) != NULL) return n->value;
+    if (find_note(NOTE_WAIT, header)) return 1;
+    if ((n = find_note(NOTE_LOOP, routine_of(entry))) != NULL) return n->value;
+    if (find_note(NOTE_WAIT, routine_of(entry))) return 1;
+    for (i = 0; i < nreported; i++) {
+        if (reported[i] == header) return 1;
+    }
+    if (nreported < MAX_NOTES) reported[nreported++] = header;
+    error("laço sem limite em %s (anotar: loop %s N)", addr_name(header), addr_name(header));
+    return 1;
+}
+
+
+//--------------------------------------------------------//
+//                 ANÁLISE DE UMA ROTINA                  //
+//--------------------------------------------------------//
+
+// Caminho mais longo a partir de "from" no grafo de blocos condensado,
+// restrito a "in_set" (NULL = todos), sem as arestas para "ignore_to".
+// Os laços já resolvidos aparecem como o nó rep[] do seu cabeçalho.
+static long longest_path(const Block* blocks, int nblocks, const int* rep, const long* node_cost,
+                         const char* in_set, int from, int ignore_to, long* dist) {
+    int* order = malloc(nblocks * sizeof(int));
+    int* indeg = calloc(nblocks, sizeof(int));
+    int i, j, head = 0, tail = 0;
+    long best = 0;
+
+    for (i = 0; i < nblocks; i++) dist[i] = -1;
+
+    // Kahn a partir de "from", só entre os nós alcançáveis
+    {
+        char* reach = calloc(nblocks + 1, 1);
+        int* stack = malloc(nblocks * sizeof(int));
+        int sp = 0;
+        reach[from] = 1;
+        stack[sp++] = from;
+        while (sp) {
+            int b = stack[--sp];
+            for (i = 0; i < nblocks; i++) {
+                if (rep[i] != b) continue;
+                for (j = 0; j < 2; j++) {
+                    int s = blocks[i].succ[j];
+                    if (s < 0 || (in_set && !in_set[s]) || s == ignore_to) continue;
+                    s = rep[s];
+                    if (s == b) continue;
+                    indeg[s]++;
+                    if (!reach[s]) {
+                        reach[s] = 1;
+                        stack[sp++] = s;
+                    }
+                }
+            }
+        }
+        free(stack);
+        free(reach);
+    }
+
+    order[tail++] = from;
+    dist[from] = node_cost[from];
+    while (head < tail) {
+        int b = order[head++];
+        if (dist[b] > best) best = dist[b];
+        for (i = 0; i < nblocks; i++) {
+            if (rep[i] != b) continue;
+            for (j = 0; j < 2; j++) {
+                int s = blocks[i].succ[j];
+                if (s < 0 || (in_set && !in_set[s]) || s == ignore_to) continue;
+                s = rep[s];
+                if (s == b) continue;
+                if (dist[b] + blocks[i].edge[j] + node_cost[s] > dist[s]) {
+                    dist[s] = dist[b] + blocks[i].edge[j] + node_cost[s];
+                }
+                if (--indeg[s] == 0) order[tail++] = s;
+            }
+        }
+    }
+    for (i = 0; i < nblocks; i++) {
+        if (indeg[i] > 0) {
+            error("laço irredutível perto de $%04X", blocks[i].start);
+            break;
+        }
+    }
+    free(order);
+    free(indeg);
+    return best;
+}
+
+// Analisa a rotina em "entry". "stop" (ou NO_ADDR) termina os caminhos
+// antes da instrução nesse endereço ou de um jsr para ele. Com "frame",
+// devolve uma iteração do laço mais externo em vez do pior caso inteiro.
+static long analyze(int bank, int entry, int stop, int frame, int* nloops, int disasm) {
+    Insn* insns = NULL;
+    int ninsns = 0, cap = 0;
+    int* insn_at = malloc(0x10000 * sizeof(int));
+    char* leader = calloc(0x10000, 1);
+    int* work = malloc(0x10000 * sizeof(int));
+    int nwork = 0;
+    Block* blocks;
+    int nblocks = 0;
+    int* block_at = malloc(0x10000 * sizeof(int));
+    int *rep, *dfs_state, *stack, *edge_next;
+    long *node_cost, *dist;
+    int i, j;
+    long result = 0, frame_iter = -1, totals = 0;
+
+    for (i = 0; i < 0x10000; i++) insn_at[i] = block_at[i] = -1;
+
+    // 1. Instruções alcançáveis e líderes dos blocos
+    leader[entry] = 1;
+    work[nwork++] = entry;
+    while (nwork) {
+        int a = work[--nwork];
+        Insn in;
+        int len;
+
+        while (a >= 0 && insn_at[a] < 0) {
+            if (a == stop) {
+                leader[a] = 1;
+                break;
+            }
+            len = decode(bank, a, &in);
+            if (!len) {
+                error("instrução inválida ou fora da ROM em $%04X", a);
+                break;
+            }
+            if (ninsns == cap) {
+                cap = cap ? cap * 2 : 256;
+                insns = realloc(insns, cap * sizeof(Insn));
+            }
+            insn_at[a] = ninsns;
+            insns[ninsns++] = in;
+
+            if (in.op->op == M_JSR && stop != NO_ADDR && reaches(in.operand, stop)) {
+                break;
+            } else if (is_branch(&in)) {
+                leader[in.operand] = 1;
+                leader[(a + len) & 0xFFFF] = 1;
+                work[nwork++] = in.operand;
+                a = (a + len) & 0xFFFF;
+                continue;
+            } else if (in.op->op == M_JMP && in.op->mode == AM_ABS && !is_tail_call(&in, entry)) {
+                leader[in.operand] = 1;
+                work[nwork++] = in.operand;
+                break;
+            } else if (ends_block(&in, entry)) {
+                break;
+            } else if (in.op->op == M_BRK) {
+                error("brk em $%04X", a);
+                break;
+            }
+            a = (a + len) & 0xFFFF;
+            if (leader[a]) {
+                work[nwork++] = a;
+                break;
+            }
+        }
+    }
+
+    // 2. Blocos
+    blocks = calloc(ninsns + 1, sizeof(Block));
+    for (i = 0; i < 0x10000; i++) {
+        int k, first;
+        Block* b;
+
+        if (!leader[i]) continue;
+        b = &blocks[nblocks];
+        b->start = i;
+        b->succ[0] = b->succ[1] = -1;
+        block_at[i] = nblocks++;
+        if (i == stop || insn_at[i] < 0) continue;      // parada: bloco vazio
+        first = insn_at[i];
+        b->first = first;
+        for (k = i; ; ) {
+            const Insn* in = &insns[insn_at[k]];
+            int next = (k + m6502_mode_bytes[in->op->mode]) & 0xFFFF;
+            b->count++;
+            if (in->op->op == M_JSR && in->operand == stop) break;
+            b->cost += insn_cost(bank, entry, insns, insn_at[k], first);
+            if (ends_block(in, entry) || leader[next] || insn_at[next] < 0) break;
+            k = next;
+        }
+    }
+
+    // Sucessores
+    for (i = 0; i < nblocks; i++) {
+        Block* b = &blocks[i];
+        const Insn* last;
+        int next;
+
+        if (!b->count) continue;
+        last = &insns[b->first + b->count - 1];
+        next = (last->addr + m6502_mode_bytes[last->op->mode]) & 0xFFFF;
+        if (last->op->op == M_JSR && last->operand == stop) continue;
+        if (is_branch(last)) {
+            b->succ[0] = block_at[last->operand];
+            b->edge[0] = 1 + (((next ^ last->operand) & 0xFF00) ? 1 : 0);
+            b->succ[1] = block_at[next];
+        } else if (last->op->op == M_JMP && last->op->mode == AM_ABS && !is_tail_call(last, entry)) {
+            b->succ[0] = block_at[last->operand];
+        } else if (!ends_block(last, entry) && block_at[next] >= 0) {
+            b->succ[0] = block_at[next];
+        }
+    }
+
+    if (disasm) {
+        for (i = 0; i < nblocks; i++) {
+            const Block* b = &blocks[i];
+            printf("bloco %s ($%04X), %ld ciclos\n", addr_name(b->start), b->start, b->cost);
+            for (j = 0; j < b->count; j++) {
+                const Insn* in = &insns[b->first + j];
+                printf("    $%04X  %s", in->addr, m6502_names[in->op->op]);
+                switch (in->op->mode) {
+                    case AM_IMM: printf(" #$%02X", in->operand); break;
+                    case AM_ZP:  printf(" $%02X", in->operand); break;
+                    case AM_ZPX: printf(" $%02X,x", in->operand); break;
+                    case AM_ZPY: printf(" $%02X,y", in->operand); break;
+                    case AM_IZX: printf(" ($%02X,x)", in->operand); break;
+                    case AM_IZY: printf(" ($%02X),y", in->operand); break;
+                    case AM_ABS: case AM_REL: printf(" $%04X", in->operand); break;
+                    case AM_ABX: printf(" $%04X,x", in->operand); break;
+                    case AM_ABY: printf(" $%04X,y", in->operand); break;
+                    case AM_IND: printf(" ($%04X)", in->operand); break;
+                }
+                if (m6502_mode_bytes[in->op->mode] == 3 || in->op->mode == AM_REL) {
+                    const char* target = symbol_at(in->operand);
+                    if (target) printf("  ; %s", target);
+                }
+                printf("\n");
+            }
+        }
+    }
+
+    // 3. Laços: arestas de volta numa busca em profundidade a partir da entrada
+    rep = malloc(nblocks * sizeof(int));
+    node_cost = malloc(nblocks * sizeof(long));
+    dist = malloc(nblocks * sizeof(long));
+    dfs_state = calloc(nblocks, sizeof(int));
+    stack = malloc(nblocks * sizeof(int));
+    edge_next = calloc(nblocks, sizeof(int));
+    for (i = 0; i < nblocks; i++) {
+        rep[i] = i;
+        node_cost[i] = blocks[i].cost;
+    }
+
+    {
+        // cabeçalhos e corpos (laço natural de cada aresta de volta)
+        char** body = calloc(nblocks, sizeof(char*));
+        int* size = calloc(nblocks, sizeof(int));
+        int sp = 0;
+        int* order;
+        int nheaders = 0;
+
+        stack[sp++] = block_at[entry];
+        dfs_state[block_at[entry]] = 1;
+        while (sp) {
+            int b = stack[sp - 1];
+            if (edge_next[b] < 2) {
+                int s = blocks[b].succ[edge_next[b]++];
+                if (s < 0) continue;
+                if (dfs_state[s] == 1) {
+                    // b -> s volta para s: corpo = quem chega em b sem passar por s
+                    int* q = malloc(nblocks * sizeof(int));
+                    int qh = 0, qt = 0;
+                    if (!body[s]) {
+                        body[s] = calloc(nblocks, 1);
+                        body[s][s] = 1;
+                        nheaders++;
+                    }
+                    if (!body[s][b]) {
+                        body[s][b] = 1;
+                        q[qt++] = b;
+                    }
+                    while (qh < qt) {
+                        int x = q[qh++];
+                        for (i = 0; i < nblocks; i++) {
+                            for (j = 0; j < 2; j++) {
+                                if (blocks[i].succ[j] == x && !body[s][i]) {
+                                    body[s][i] = 1;
+                                    q[qt++] = i;
+                                }
+                            }
+                        }
+                    }
+                    free(q);
+                } else if (dfs_state[s] == 0) {
+                    dfs_state[s] = 1;
+                    stack[sp++] = s;
+                }
+            } else {
+                dfs_state[b] = 2;
+                sp--;
+            }
+        }
+
+        // do laço mais interno (menor corpo) para o mais externo
+        order = malloc((nheaders + 1) * sizeof(int));
+        nheaders = 0;
+        for (i = 0; i < nblocks; i++) {
+            if (!body[i]) continue;
+            for (j = 0; j < nblocks; j++) size[i] += body[i][j];
+            order[nheaders++] = i;
+        }
+        for (i = 1; i < nheaders; i++) {
+            for (j = i; j > 0 && size[order[j]] < size[order[j - 1]]; j--) {
+                int t = order[j];
+                order[j] = order[j - 1];
+                order[j - 1] = t;
+            }
+        }
+        *nloops = nheaders;
+
+        for (i = 0; i < nheaders; i++) {
+            int h = order[i];
+            long iter = longest_path(blocks, nblocks, rep, node_cost, body[h], h, h, dist);
+            int outer = frame && i == nheaders - 1;
+            int innermost = 1;
+            const Note* total = NULL;
+
+            for (j = 0; j < nblocks; j++) {
+                if (j != h && body[j] && body[h][j]) innermost = 0;
+            }
+
+            // a volta pela aresta de volta (desvio tomado) também custa
+            for (j = 0; j < nblocks; j++) {
+                int k;
+                if (!body[h][j] || dist[rep[j]] < 0) continue;
+                for (k = 0; k < 2; k++) {
+                    if (blocks[j].succ[k] == h && dist[rep[j]] + blocks[j].edge[k] > iter) {
+                        iter = dist[rep[j]] + blocks[j].edge[k];
+                    }
+                }
+            }
+            if (outer) frame_iter = iter;
+            if (!outer) {
+                total = find_note(NOTE_TOTAL, blocks[h].start);
+                if (!total && innermost) total = find_note(NOTE_TOTAL, routine_of(entry));
+            }
+            if (total) {
+                // limite por chamada da rotina: entra uma vez no resultado,
+                // fora dos laços que o envolvem
+                node_cost[h] = 0;
+                totals += iter * total->value;
+            } else {
+                node_cost[h] = iter * (outer ? 1 : loop_bound(blocks[h].start, entry));
+            }
+            if (verbose) {
+                printf("    laço %s: %ld ciclos por volta, %ld no total\n",
+                       addr_name(blocks[h].start), iter, total ? iter * total->value : node_cost[h]);
+            }
+            for (j = 0; j < nblocks; j++) {
+                if (body[h][j]) rep[j] = h;
+            }
+            // nós que apontavam para um corpo já resolvido passam a ser o cabeçalho
+            for (j = 0; j < nblocks; j++) {
+                if (rep[rep[j]] != rep[j]) rep[j] = rep[rep[j]];
+            }
+        }
+        for (i = 0; i < nblocks; i++) free(body[i]);
+        free(body);
+        free(size);
+        free(order);
+    }
+
+    // 4. Pior caso: caminho mais longo da entrada até qualquer saída
+    result = longest_path(blocks, nblocks, rep, node_cost, NULL, rep[block_at[entry]], -1, dist) + totals;
+    if (frame) {
+        if (frame_iter < 0) {
+            error("frame: %s sem laço", addr_name(entry));
+            frame_iter = 0;
+        }
+        result = frame_iter + totals;
+    }
+
+    free(insns);
+    free(insn_at);
+    free(leader);
+    free(work);
+    free(block_at);
+    free(blocks);
+    free(rep);
+    free(node_cost);
+    free(dist);
+    free(dfs_state);
+    free(stack);
+    free(edge_next);
+    return result;
+}
+
+static long function_wcet(int bank, int entry) {
+    const Note* n = find_note(NOTE_COST, entry);
+    Function* f;
+    int i, tramp = tramp_depth > 0;
+
+    if (n) return n->value;
+    if (!in_window(entry)) bank = NO_BANK;
+    for (i = 0; i < nfuncs; i++) {
+        f = &funcs[i];
+        if (f->bank == bank && f->entry == entry && f->tramp == tramp) {
+            if (f->state == 1) {
+                error("recursão em %s", addr_name(entry));
+                return 0;
+            }
+            return f->wcet;
+        }
+    }
+    if (nfuncs == MAX_FUNCS) {
+        error("rotinas demais ($%04X)", entry);
+        return 0;
+    }
+    f = &funcs[nfuncs++];
+    f->bank = bank;
+    f->entry = entry;
+    f->tramp = tramp;
+    f->state = 1;
+    if (verbose) printf("  %s\n", addr_name(entry));
+    f->wcet = analyze(bank, entry, NO_ADDR, 0, &f->loops, 0);
+    f->state = 2;
+    return f->wcet;
+}
+
+
+//--------------------------------------------------------//
+//                       MAIN                             //
+//--------------------------------------------------------//
+
+static int compare_funcs(const void* a, const void* b) {
+    const Function* fa = a;
+    const Function* fb = b;
+    if (fa->entry != fb->entry) return fa->entry - fb->entry;
+    return fa->bank - fb->bank;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "uso: %s [-v] [--disasm ROTINA] rom.nes mapfile anotações\n", prog);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    const char* files[3];
+    const char* disasm = NULL;
+    int nfiles = 0, i, loops, over = 0;
+    long frame_iter = 0, nmi = 0, vblank = 0, irq = 0, total;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-v")) verbose = 1;
+        else if (!strcmp(argv[i], "--disasm") && i + 1 < argc) disasm = argv[++i];
+        else if (argv[i][0] != '-' && nfiles < 3) files[nfiles++] = argv[i];
+        else usage(argv[0]);
+    }
+    if (nfiles != 3) usage(argv[0]);
+
+    load_rom(files[0]);
+    load_map(files[1]);
+    load_notes(files[2]);
+
+    if (disasm) {
+        int a = parse_addr(disasm, 1);
+        if (a == NO_ADDR) return 2;
+        printf("%s: pior caso %ld ciclos\n", addr_name(a), analyze(NO_BANK, a, NO_ADDR, 0, &loops, 1));
+        return errors ? 2 : 0;
+    }
+
+    if (root_frame != NO_ADDR) frame_iter = analyze(NO_BANK, root_frame, NO_ADDR, 1, &loops, 0);
+    if (root_nmi != NO_ADDR) nmi = function_wcet(NO_BANK, root_nmi);
+    if (root_vblank != NO_ADDR) vblank = analyze(NO_BANK, root_vblank, vblank_stop, 0, &loops, 0);
+    if (root_irq != NO_ADDR) irq = function_wcet(NO_BANK, root_irq);
+
+    qsort(funcs, nfuncs, sizeof(Function), compare_funcs);
+    printf("rotina                                  banco   laços   pior caso\n");
+    for (i = 0; i < nfuncs; i++) {
+        const Function* f = &funcs[i];
+        char bank[8] = "fixo";
+        if (f->bank != NO_BANK) snprintf(bank, sizeof(bank), "%d", f->bank);
+        printf("%-38s  %5s  %6d  %10ld%s\n", addr_name(f->entry), bank, f->loops, f->wcet,
+               f->tramp ? "  (no trampolim)" : "");
+    }
+
+    total = frame_iter + nmi + irq * irq_count;
+    printf("\n");
+    if (root_frame != NO_ADDR) {
+        printf("quadro: laço de %s %ld + NMI %ld + %ld IRQ x %ld = %ld de %ld ciclos%s\n",
+               addr_name(root_frame), frame_iter, nmi, irq_count, irq, total, budget_frame,
+               total > budget_frame ? "  ESTOURO" : "");
+        if (total > budget_frame) over = 1;
+    }
+    if (root_vblank != NO_ADDR) {
+        printf("vblank: %s até %s %ld de %ld ciclos%s\n", addr_name(root_vblank),
+               addr_name(vblank_stop), vblank, budget_vblank,
+               vblank > budget_vblank ? "  ESTOURO" : "");
+        if (vblank > budget_vblank) over = 1;
+    }
+    if (errors) {
+        fprintf(stderr, "%d erro(s): análise incompleta\n", errors);
+        return 2;
+    }
+    return over ? 1 : 0;
+}
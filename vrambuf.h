@@ -8,7 +8,10 @@
 #define VBUFSIZE 128
 
 // update buffer starts at $100 (stack page)
+// (the host build in tools/fuzz_logic.c defines its own array first)
+#ifndef updbuf
 #define updbuf ((byte*)0x100)
+#endif
 
 // index to end of buffer
 extern byte updptr;
@@ -23,6 +26,22 @@ extern byte updptr;
   VRAMBUF_ADD(addr);\
   VRAMBUF_ADD(len);
 
+// per-frame upload cap: flush_vram_update() has to finish inside the
+// vblank (2273 cycles) after the NMI entry and OAM DMA (513). A run costs
+// about 70 cycles plus 16 per data byte, so a 1-byte run (4 bytes in the
+// buffer) is the worst case at ~22 cycles per buffer byte
+#define VRAMBUF_VBLANK_CYCLES 2273
+#define VRAMBUF_NMI_CYCLES    640   // entry, OAM DMA, scroll and margin
+#define VRAMBUF_BYTE_CYCLES   22
+#define VRAMBUF_FRAME_MAX ((VRAMBUF_VBLANK_CYCLES-VRAMBUF_NMI_CYCLES)/VRAMBUF_BYTE_CYCLES)
+
+// true if "bytes" more buffer bytes fit in this frame's upload cap
+#define VRAMBUF_ROOM(bytes) (updptr+(bytes) <= VRAMBUF_FRAME_MAX)
+
+// true if a run of len bytes (header + data) fits in this frame's
+// upload cap; optional updates check this before vrambuf_put()
+#define VRAMBUF_FITS(len) VRAMBUF_ROOM(3+(len))
+
 // OR with address to put vertical run
 #define VRAMBUF_VERT	0x8000
 